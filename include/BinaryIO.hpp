@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// Minimal host-endian record encoding for files this process writes and
+// reads back itself (see WarmStart, RecordingWriter). Strings are a u32 length plus bytes.
+namespace BinaryIO
+{
+    template <typename T>
+    void put(std::string& out, T value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    inline void putString(std::string& out, std::string_view text)
+    {
+        put(out, static_cast<std::uint32_t>(text.size()));
+        out.append(text.data(), text.size());
+    }
+
+    // Reads fail soft: after the first short read ok() is false and every
+    // later read returns a default value.
+    class Reader
+    {
+    private:
+        std::string_view in;
+        bool good = true;
+
+    public:
+        explicit Reader(std::string_view bytes) : in(bytes) {}
+
+        [[nodiscard]] bool ok() const noexcept { return good; }
+        [[nodiscard]] bool atEnd() const noexcept { return in.empty(); }
+        [[nodiscard]] std::size_t remaining() const noexcept { return in.size(); }
+
+        template <typename T>
+        T get()
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            T value{};
+            if (!good || in.size() < sizeof(T))
+            {
+                good = false;
+                return value;
+            }
+            std::memcpy(&value, in.data(), sizeof(T));
+            in.remove_prefix(sizeof(T));
+            return value;
+        }
+
+        std::string_view getBytes(std::size_t size)
+        {
+            if (!good || in.size() < size)
+            {
+                good = false;
+                return {};
+            }
+            std::string_view bytes = in.substr(0, size);
+            in.remove_prefix(size);
+            return bytes;
+        }
+
+        std::string_view getString()
+        {
+            return getBytes(get<std::uint32_t>());
+        }
+    };
+
+    // FNV-1a, for content fingerprints and checksums rather than hash tables.
+    inline std::uint64_t fnv1a(std::string_view bytes, std::uint64_t hash = 14695981039346656037ull)
+    {
+        for (unsigned char c : bytes)
+        {
+            hash ^= c;
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+}
@@ -1,5 +1,6 @@
 #include <string>
 #include <vector>
+#include <chrono>
 
 struct FeedEndpoint
 {
@@ -30,6 +31,8 @@ public:
     ConfigurationManager();
     static inline const std::string MTA_HOST   = "api-endpoint.mta.info";
     static inline const std::string MTA_PORT   = "443";
+    // Upper bound for one feed's connect + request + response within a poll cycle.
+    static inline const std::chrono::seconds FEED_TIMEOUT{10};
 
     [[nodiscard]] std::string getAPIKey() const noexcept;
     [[nodiscard]] std::vector<FeedEndpoint> const& getFeeds() const noexcept;
@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Read-only memory map of a whole file (mmap on POSIX, a file mapping on
+// Windows). view() stays valid for the lifetime of the object.
+class MappedFile
+{
+private:
+    const char* data = nullptr;
+    std::size_t length = 0;
+    bool opened = false;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+
+    void release() noexcept;
+
+public:
+    explicit MappedFile(std::string const& path);
+    ~MappedFile();
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(MappedFile const&) = delete;
+    MappedFile& operator=(MappedFile const&) = delete;
+
+    [[nodiscard]] bool isOpen() const noexcept { return opened; }
+    [[nodiscard]] std::string_view view() const noexcept { return { data, length }; }
+};
+
+// RFC 4180 reader over a text buffer. Fields are views into the buffer, so a
+// record costs no allocation unless a quoted field contains "" escapes; those
+// are unescaped into the reader's scratch space. Records end at \n or \r\n.
+//
+// Fields returned by field() are valid until the next call to next().
+class CsvReader
+{
+private:
+    struct Span
+    {
+        std::size_t offset;
+        std::size_t size;
+        bool inScratch;
+    };
+
+    std::string_view text;
+    std::size_t pos = 0;
+    std::vector<Span> spans;
+    std::vector<std::string_view> fields;
+    std::string scratch;
+    std::vector<std::string> headerNames;
+
+public:
+    explicit CsvReader(std::string_view buffer);
+
+    // Reads the first record as column names.
+    bool readHeader();
+    // Index of a header column, or fallback if the header doesn't name it.
+    [[nodiscard]] std::size_t column(std::string_view name, std::size_t fallback) const;
+
+    bool next();
+    [[nodiscard]] std::size_t size() const noexcept { return fields.size(); }
+    // Empty for a column the record doesn't have.
+    [[nodiscard]] std::string_view field(std::size_t index) const noexcept
+    {
+        return index < fields.size() ? fields[index] : std::string_view();
+    }
+    [[nodiscard]] std::size_t offset() const noexcept { return pos; }
+};
@@ -1,20 +1,23 @@
 #pragma once
+#include <cstdint>
 #include <string>
 #include <vector>
 
 struct TrainSnapshot;
+struct DwellPercentiles;
 class StopManager;
 
 class Dashboard
 {
 public:
     static std::string generate(std::vector<TrainSnapshot> const& stalledTrains,
-                                StopManager& stops);
+                                DwellPercentiles const& lastDay,
+                                StopManager const& stops);
 
 private:
-    static int computeNowSec();
-    static std::string buildHtmlHead(std::size_t stalledCount);
+    static std::string formatClock(std::int64_t epochSeconds);    // HH:MM:SS in New York
+    static std::string buildHtmlHead(std::size_t stalledCount, DwellPercentiles const& lastDay);
     static std::string buildTableHeader();
-    static std::string formatLateness(TrainSnapshot const& t, int nowSec);
-    static std::string buildRow(TrainSnapshot const& t, StopManager& stops, int nowSec);
+    static std::string formatLateness(TrainSnapshot const& t, std::int64_t now);
+    static std::string buildRow(TrainSnapshot const& t, StopManager const& stops, std::int64_t now);
 };
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Log-linear (HDR-style) histogram of dwell times in seconds. Values below 32
+// are counted exactly; above that every power of two is split into 16
+// buckets, so any quantile is within ~3% of the true value. Sketches with
+// the same layout merge by adding bucket counts, which is what lets hourly
+// per-station sketches answer percentiles over any range.
+class DwellSketch
+{
+public:
+    void add(std::uint32_t seconds, std::uint64_t count = 1);
+    void merge(DwellSketch const& other);
+
+    [[nodiscard]] std::uint64_t count() const noexcept { return total; }
+    [[nodiscard]] std::uint32_t quantile(double q) const;
+
+    // Sparse form: a version byte, then varint (index delta, count) pairs.
+    [[nodiscard]] std::string serialize() const;
+    static bool deserialize(std::string_view bytes, DwellSketch& out);
+
+private:
+    static constexpr unsigned SUB_BUCKET_BITS = 4;
+    static constexpr std::uint32_t SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+    static constexpr std::uint8_t FORMAT_VERSION = 1;
+
+    std::vector<std::uint64_t> buckets;
+    std::uint64_t total = 0;
+
+    static std::size_t indexOf(std::uint32_t value) noexcept;
+    static std::uint32_t lowerBound(std::size_t index) noexcept;
+    static std::uint32_t width(std::size_t index) noexcept;
+};
+
+// Percentiles of one merged sketch; all zero when no stall fell in range.
+struct DwellPercentiles
+{
+    std::uint64_t stalls = 0;
+    std::uint32_t p50 = 0;
+    std::uint32_t p95 = 0;
+    std::uint32_t p99 = 0;
+};
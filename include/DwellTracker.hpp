@@ -0,0 +1,90 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "Types.hpp"
+
+// Keeps the running dwell of every (trip, stop) pair seen STOPPED_AT, updated
+// one snapshot at a time as ingest writes them. After each write the current
+// stalls are published as an immutable list, so readers take a shared_ptr
+// copy instead of re-running the GROUP BY over the last 30 minutes.
+//
+// A dwell closes when its train is next seen anywhere else (or drops out of
+// the window); stalls that close are queued for takeClosed() so the store can
+// fold them into its percentile sketches.
+//
+// observe(), publish() and takeClosed() must be called by one writer at a
+// time (the store calls them under its write lock); current() is safe from
+// any thread.
+class DwellTracker
+{
+public:
+    using StallList = std::vector<TrainSnapshot>;
+    // Scheduled arrival (epoch seconds) of the trip at the stop it reached at seenAt, or -1.
+    using ScheduleLookup = std::function<std::int64_t(std::string const& tripId, std::string const& stopId, std::uint64_t seenAt)>;
+
+    struct ClosedDwell
+    {
+        std::string stopId;
+        std::string routeId;
+        std::uint64_t firstSeen = 0;
+        std::uint32_t dwellSeconds = 0;
+    };
+
+    static constexpr std::int64_t MIN_DWELL_SECONDS = 60;    // held longer than this is a stall
+    static constexpr std::int64_t RECENT_SECONDS    = 60;    // ...if it was still there this recently
+    static constexpr std::int64_t WINDOW_SECONDS    = 1800;  // entries not seen for this long are dropped
+
+    DwellTracker();
+
+    void observe(TrainSnapshot const& s);
+    // Rebuilds one dwell from stored rows. lastMoving is when the trip was last seen not
+    // stopped (0 if never); a dwell it left before then, or one followed by a later stop,
+    // was already closed and recorded, so it is seeded closed and never recorded again.
+    void seed(TrainSnapshot const& s, std::uint64_t firstSeen, std::uint64_t lastSeen, std::uint64_t lastMoving);
+    void publish(std::int64_t now, ScheduleLookup const& lookupSchedule);
+    // Drops cached scheduled arrivals so the next publish looks them up again.
+    void forgetSchedules();
+
+    [[nodiscard]] std::shared_ptr<const StallList> current() const;
+    [[nodiscard]] std::vector<ClosedDwell> takeClosed();
+
+    // Full state for WarmStart. restore() replaces it and returns the newest
+    // timestamp it held, so the caller can replay only what came after.
+    void serialize(std::string& out) const;
+    bool restore(std::string_view bytes, std::uint64_t& newestSeen);
+    [[nodiscard]] std::size_t size() const noexcept { return entries.size(); }
+
+    static bool isExcludedStop(std::string const& stopId);
+
+private:
+    struct Entry
+    {
+        std::string routeId;
+        std::string trainId;
+        int32_t direction = 0;
+        int32_t currentStatus = 0;
+        bool isAssigned = false;
+        std::uint64_t firstSeen = 0;
+        std::uint64_t lastSeen = 0;
+        int32_t maxDelay = 0;
+        std::int64_t scheduledArrival = -1;    // -1 until looked up, 0 if the schedule has no match
+        bool closed = false;             // dwell already handed to closedDwells (at most once)
+    };
+
+    // tripId + '\x1f' + stopId
+    std::unordered_map<std::string, Entry> entries;
+    // tripId -> stopId of the entry the trip is currently stopped at
+    std::unordered_map<std::string, std::string> openStops;
+    std::vector<ClosedDwell> closedDwells;
+    std::atomic<std::shared_ptr<const StallList>> published;
+
+    static std::string makeKey(std::string const& tripId, std::string const& stopId);
+    void close(std::string const& stopId, Entry& entry);
+    void closeDeparted(TrainSnapshot const& s);
+};
@@ -0,0 +1,28 @@
+#pragma once
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+// Remembers the last feed body accepted for one endpoint so an identical
+// re-poll can skip parsing and inserting. The header timestamp is checked
+// first since it is a few bytes into the message; the body hash only runs
+// when the timestamps match.
+class FeedChangeDetector
+{
+private:
+    std::uint64_t lastTimestamp = 0;
+    std::size_t lastHash = 0;
+    bool hasLast = false;
+
+    std::size_t processed = 0;
+    std::size_t unchangedSkips = 0;
+    std::size_t notModifiedSkips = 0;
+
+public:
+    bool isUnchanged(std::string_view body);
+    void recordNotModified() noexcept { ++notModifiedSkips; }
+
+    [[nodiscard]] std::size_t getProcessed() const noexcept { return processed; }
+    [[nodiscard]] std::size_t getUnchangedSkips() const noexcept { return unchangedSkips; }
+    [[nodiscard]] std::size_t getNotModifiedSkips() const noexcept { return notModifiedSkips; }
+};
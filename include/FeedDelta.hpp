@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Entity-level delta coding of consecutive GTFS-RT snapshots of one feed.
+//
+// A FeedMessage is a run of top-level fields: the header, then one field per
+// FeedEntity. A delta lists the new message as copies of runs of fields from
+// the previous message and literal fields in between:
+//     op        varint (count << 1 | 1), varint start    copy fields [start, start + count) of the previous message
+//               varint (length << 1)                     then length bytes of new fields
+// Entities are matched by (trip_update | vehicle, trip_id), or by entity id
+// when they carry no trip, so an entity that is unchanged since the last
+// poll costs a few bytes wherever it moved to; added and changed entities and
+// the header are stored whole, and removed ones are simply not copied. The
+// decoder rebuilds the exact bytes of the original message.
+class FeedDeltaEncoder
+{
+public:
+    // Makes message the base for the next delta. Unless keyframe is set,
+    // first writes into delta the difference from the previous message and
+    // returns true; false if the message must be stored whole (a keyframe,
+    // the first message, bytes that do not parse, or a delta no smaller).
+    bool encode(std::string_view message, bool keyframe, std::string& delta);
+    void reset();
+
+private:
+    struct Key
+    {
+        std::uint32_t kind = 0;    // FeedEntity field number: trip_update, vehicle, or 1 for the entity id
+        std::string_view id;
+
+        bool operator==(Key const& other) const noexcept { return kind == other.kind && id == other.id; }
+    };
+    struct KeyHash
+    {
+        std::size_t operator()(Key const& key) const noexcept
+        {
+            return std::hash<std::string_view>()(key.id) ^ (static_cast<std::size_t>(key.kind) << 1);
+        }
+    };
+
+    std::string previous;
+    std::vector<std::uint32_t> bounds;                       // field i is previous[bounds[i], bounds[i + 1])
+    std::unordered_map<Key, std::uint32_t, KeyHash> fields;  // key -> first field with it; views into previous
+
+    // Empty (kind 0) for the header and for entities with neither a trip nor an id.
+    static Key keyOf(std::string_view field);
+    void adopt(std::string_view message, std::vector<std::uint32_t>&& messageBounds);
+};
+
+class FeedDeltaDecoder
+{
+public:
+    [[nodiscard]] bool hasBase() const noexcept { return !bounds.empty(); }
+    // A whole message, stored as a keyframe; false if it does not parse.
+    bool setBase(std::string_view message);
+    // Rebuilds the next message from a delta into message; false if there is
+    // no base or the delta does not apply, after which a keyframe is needed.
+    bool apply(std::string_view delta, std::string& message);
+    void reset();
+
+private:
+    std::string current;
+    std::vector<std::uint32_t> bounds;
+    std::string scratch;                       // the message being rebuilt; swapped with current
+    std::vector<std::uint32_t> scratchBounds;
+};
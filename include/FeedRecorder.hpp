@@ -0,0 +1,102 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "MpscQueue.hpp"
+#include "Recording.hpp"
+
+// When a recording moves on to a new file, and how often it is forced to disk.
+struct RecordingPolicy
+{
+    std::uint64_t maxFileBytes = 512ull << 20;    // 0: no size limit
+    bool hourly = false;                          // also start a new file at each UTC hour
+    std::chrono::seconds syncInterval{60};
+    std::uint32_t keyframeInterval = 0;           // >0: delta-code frames between keyframes (see FeedDelta.hpp)
+};
+
+// Snapshot figures published by the recorder thread for the poll loop report.
+struct RecorderStats
+{
+    std::size_t queueDepth = 0;
+    std::uint64_t frames = 0;
+    std::uint64_t droppedFrames = 0;
+    std::uint64_t files = 0;
+    std::uint64_t rawBytesPerSecond = 0;       // over the last sync interval
+    std::uint64_t storedBytesPerSecond = 0;
+};
+
+// Writes feed bodies to .rec files on a dedicated thread. record() copies the
+// body into a queue and returns; compression, file writes, fsync and rotation
+// all happen on the recorder thread. The queue is bounded by QUEUE_BYTES: a
+// frame that would overflow it is dropped and counted rather than making the
+// poll loop wait on the disk.
+//
+// Files are named after the base path: the first is the path itself, later
+// ones insert -2, -3, ... before the extension. Names that already exist are
+// skipped, so an earlier run's files are never overwritten.
+class FeedRecorder
+{
+public:
+    static constexpr std::size_t QUEUE_BYTES = 64 << 20;
+
+private:
+    struct Job
+    {
+        enum class Kind { Frame, Sync, Stop };
+
+        Kind kind = Kind::Frame;
+        std::uint64_t timestamp = 0;
+        std::uint16_t feedId = 0;
+        std::string data;
+    };
+
+    std::string basePath;
+    std::vector<std::string> feedNames;
+    RecordingPolicy policy;
+    MpscQueue<Job> queue;
+    std::atomic<std::size_t> queuedBytes{0};
+
+    // Recorder thread only.
+    std::unique_ptr<RecordingWriter> file;
+    std::uint64_t fileHour = 0;
+    std::uint64_t nextNumber = 1;      // suffix to try for the next file
+    std::uint64_t closedRaw = 0;       // totals of the files already closed
+    std::uint64_t closedStored = 0;
+    std::uint64_t lastRaw = 0;         // totals at the last sync
+    std::uint64_t lastStored = 0;
+    std::chrono::steady_clock::time_point lastSync = std::chrono::steady_clock::now();
+
+    std::atomic<std::uint64_t> frames{0};
+    std::atomic<std::uint64_t> dropped{0};
+    std::atomic<std::uint64_t> files{0};
+    std::atomic<std::uint64_t> rawRate{0};
+    std::atomic<std::uint64_t> storedRate{0};
+    std::thread worker;     // last, so everything above exists before run() starts
+
+    void run();
+    void writeFrame(Job const& job);
+    void openFile(std::uint64_t timestamp);
+    void closeFile();
+    void sync();
+    [[nodiscard]] std::string pathOf(std::uint64_t number) const;
+
+public:
+    FeedRecorder(std::string path, std::vector<std::string> feeds, RecordingPolicy rotation);
+    ~FeedRecorder();
+    FeedRecorder(FeedRecorder const&) = delete;
+    FeedRecorder& operator=(FeedRecorder const&) = delete;
+
+    // Copies data; false if the frame was dropped because the queue is full.
+    bool record(std::uint64_t timestamp, std::uint16_t feedId, std::string_view data);
+    // Closes the open block and fsyncs the current file.
+    void requestSync();
+
+    [[nodiscard]] RecordingPolicy const& getPolicy() const noexcept { return policy; }
+    [[nodiscard]] RecorderStats getStats() const noexcept;
+};
@@ -0,0 +1,85 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+// Unbounded lock-free multi-producer / single-consumer queue (Vyukov's
+// intrusive node design). push() may be called from any thread; pop() and
+// waitForPushAfter() only from the one consumer thread. A push is a single
+// atomic exchange, so producers never wait on each other or on the consumer.
+template <typename T>
+class MpscQueue
+{
+private:
+    struct Node
+    {
+        std::atomic<Node*> next{nullptr};
+        std::optional<T> value;
+    };
+
+    std::atomic<Node*> head;    // last pushed node; producers swap themselves in here
+    Node* tail;                 // consumer side; always a drained stub node
+    std::atomic<std::size_t> depth{0};
+    std::atomic<std::uint64_t> pushes{0};
+
+public:
+    MpscQueue()
+    {
+        Node* stub = new Node;
+        head.store(stub, std::memory_order_relaxed);
+        tail = stub;
+    }
+
+    ~MpscQueue()
+    {
+        while (tail)
+        {
+            Node* next = tail->next.load(std::memory_order_relaxed);
+            delete tail;
+            tail = next;
+        }
+    }
+
+    MpscQueue(MpscQueue const&) = delete;
+    MpscQueue& operator=(MpscQueue const&) = delete;
+
+    void push(T value)
+    {
+        Node* node = new Node;
+        node->value.emplace(std::move(value));
+
+        // Counted before the node is linked: the release store below orders it ahead of the
+        // consumer's decrement, so size() never dips below zero.
+        depth.fetch_add(1, std::memory_order_relaxed);
+
+        Node* prev = head.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+
+        pushes.fetch_add(1, std::memory_order_release);
+        pushes.notify_one();
+    }
+
+    std::optional<T> pop()
+    {
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if (!next)
+            return std::nullopt;
+
+        std::optional<T> value(std::in_place, std::move(*next->value));
+        next->value.reset();
+        delete tail;
+        tail = next;
+
+        depth.fetch_sub(1, std::memory_order_relaxed);
+        return value;
+    }
+
+    // Consumer-side blocking: read pushCount(), try pop(), and if that came back
+    // empty, wait until a producer has pushed past the count that was read.
+    [[nodiscard]] std::uint64_t pushCount() const noexcept { return pushes.load(std::memory_order_acquire); }
+    void waitForPushAfter(std::uint64_t seen) const noexcept { pushes.wait(seen, std::memory_order_acquire); }
+
+    [[nodiscard]] std::size_t size() const noexcept { return depth.load(std::memory_order_relaxed); }
+};
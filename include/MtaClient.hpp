@@ -1,4 +1,10 @@
 #include <string>
+#include <string_view>
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <cstddef>
 #include <boost/asio.hpp>
 #include <boost/asio/awaitable.hpp>
 #include <boost/asio/use_awaitable.hpp>
@@ -7,22 +13,92 @@
 #include <boost/asio/ssl.hpp>
 #include <boost/beast.hpp>
 #include <boost/beast/ssl.hpp>
+
+// Cumulative connection counters, used by the poll loop report.
+struct ClientStats
+{
+    std::size_t requests = 0;
+    std::size_t notModified = 0;
+    std::size_t reusedConnections = 0;
+    std::size_t newConnections = 0;
+    std::size_t resumedSessions = 0;
+    std::size_t staleReconnects = 0;
+    std::size_t dnsLookups = 0;
+};
+
+struct FetchResult
+{
+    std::string_view body;      // points into the caller's body buffer
+    bool notModified = false;   // 304: whatever was fetched last time for this target is still current
+    std::size_t bytesCopied = 0;     // bytes moved from the socket buffer into the body buffer
+    std::size_t bytesAllocated = 0;  // capacity the body buffer had to grow by for this response
+};
+
 class MtaClient
 {
 private:
+    using TlsStream = boost::beast::ssl_stream<boost::beast::tcp_stream>;
+
+    // A keep-alive connection to MTA_HOST. The read buffer belongs to the connection because
+    // bytes past the end of one response would belong to the next one on the same socket.
+    struct Connection
+    {
+        Connection(boost::asio::any_io_executor executor, boost::asio::ssl::context& ssl)
+            : stream(executor, ssl)
+        {}
+
+        TlsStream stream;
+        boost::beast::flat_buffer buffer;
+        std::chrono::steady_clock::time_point lastUsed;
+        std::size_t requestsServed = 0;
+    };
+
+    // Cache validators from the last 200 response for a target, echoed back as a conditional GET.
+    struct Validators
+    {
+        std::string etag;
+        std::string lastModified;
+    };
+
+    static constexpr std::size_t MAX_IDLE_CONNECTIONS = 8;
+    static constexpr std::chrono::seconds MAX_IDLE_AGE{55};
+    static constexpr std::chrono::minutes DNS_TTL{5};
+
     boost::asio::io_context& ioContext;
     boost::asio::ssl::context sslContext;
     std::string apiKey;
-    void configureTlsStream(boost::beast::ssl_stream<boost::beast::tcp_stream>& stream);
-    boost::asio::awaitable<boost::asio::ip::basic_resolver_results<boost::asio::ip::tcp>> resolve(boost::asio::ip::tcp::resolver& resolver, boost::beast::ssl_stream<boost::beast::tcp_stream>& stream);
-    boost::asio::awaitable<void> connect(boost::asio::ip::tcp::resolver::results_type results, boost::beast::ssl_stream<boost::beast::tcp_stream>& stream);
+
+    std::vector<std::unique_ptr<Connection>> idleConnections;
+    boost::asio::ip::tcp::resolver::results_type cachedEndpoints;
+    std::chrono::steady_clock::time_point dnsExpiry;
+    SSL_SESSION* tlsSession = nullptr;
+    std::unordered_map<std::string, Validators> validators;
+    ClientStats stats;
+
+    void configureTlsStream(TlsStream& stream);
+    boost::asio::awaitable<boost::asio::ip::basic_resolver_results<boost::asio::ip::tcp>> resolve();
+    boost::asio::awaitable<void> connect(boost::asio::ip::tcp::resolver::results_type results, TlsStream& stream);
+    // freshOnly skips the idle pool and always opens a new connection.
+    boost::asio::awaitable<std::unique_ptr<Connection>> acquireConnection(std::chrono::steady_clock::time_point deadline, bool freshOnly = false);
+    void retireIdleSince(std::chrono::steady_clock::time_point lastUsed);
+    void releaseConnection(std::unique_ptr<Connection> connection);
+    void rememberTlsSession(TlsStream& stream);
+    void rememberValidators(std::string const& target, boost::beast::http::response<boost::beast::http::string_body> const& response);
     boost::beast::http::request<boost::beast::http::string_body> buildGetRequest(std::string const& target) const;
-    boost::asio::awaitable<void> sendRequest(boost::beast::ssl_stream<boost::beast::tcp_stream>& stream, boost::beast::http::request<boost::beast::http::string_body> const& request);
-    boost::asio::awaitable<boost::beast::http::response<boost::beast::http::string_body>> readResponse(boost::beast::ssl_stream<boost::beast::tcp_stream>& stream);
-    boost::asio::awaitable<void> shutdownStream(boost::beast::ssl_stream<boost::beast::tcp_stream>& stream);
+    boost::asio::awaitable<void> sendRequest(TlsStream& stream, boost::beast::http::request<boost::beast::http::string_body> const& request);
+    boost::asio::awaitable<void> readResponse(Connection& connection, boost::beast::http::response<boost::beast::http::string_body>& response);
+    boost::asio::awaitable<void> shutdownStream(TlsStream& stream);
+    boost::asio::awaitable<void> retireConnection(std::unique_ptr<Connection> connection);
+    static bool isStaleConnectionError(boost::system::error_code const& ec);
 
 
 public:
     MtaClient(boost::asio::io_context& ioc, std::string key);
-    boost::asio::awaitable<std::string> fetch(std::string target);
+    ~MtaClient();
+    MtaClient(MtaClient const&) = delete;
+    MtaClient& operator=(MtaClient const&) = delete;
+
+    // The body is read into bodyBuffer, whose capacity is kept between calls; the result views it.
+    boost::asio::awaitable<FetchResult> fetch(std::string target, std::string& bodyBuffer, std::chrono::steady_clock::duration timeout);
+    [[nodiscard]] ClientStats const& getStats() const noexcept { return stats; }
 };
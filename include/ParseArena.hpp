@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+#include <google/protobuf/arena.h>
+
+// Backing memory for decoding one feed in one poll cycle. The decoded
+// FeedMessage lives on the protobuf arena and the merge scratch on the
+// monotonic resource; reset() drops both at once. The arena's first block
+// grows to the largest cycle seen so far, so a steady feed decodes without
+// touching the global allocator.
+class ParseArena
+{
+private:
+    static constexpr std::size_t INITIAL_MESSAGE_BYTES = 512 * 1024;
+    static constexpr std::size_t SCRATCH_BYTES = 256 * 1024;
+
+    std::vector<char> messageBlock;
+    std::unique_ptr<google::protobuf::Arena> messageArena;
+    std::unique_ptr<std::byte[]> scratchBlock;
+    std::pmr::monotonic_buffer_resource scratchResource;
+    std::size_t highWater = 0;
+
+    void rebuildMessageArena();
+
+public:
+    ParseArena();
+    ParseArena(ParseArena const&) = delete;
+    ParseArena& operator=(ParseArena const&) = delete;
+
+    google::protobuf::Arena* protobuf() noexcept { return messageArena.get(); }
+    std::pmr::memory_resource* scratch() noexcept { return &scratchResource; }
+
+    void reset();
+    [[nodiscard]] std::size_t getHighWater() const noexcept { return highWater; }
+};
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstddef>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <boost/asio.hpp>
+#include <boost/asio/awaitable.hpp>
+#include <boost/asio/use_awaitable.hpp>
+#include <boost/asio/thread_pool.hpp>
+
+// Fixed-size worker pool for CPU-bound feed decoding. A coroutine on the
+// io_context hands a job over with co_await submit(...) and resumes on its
+// own executor once a worker has finished it, so the network side keeps
+// running while feeds decode on other cores. Jobs are bounded by the caller:
+// the poll loop keeps at most one decode in flight per feed.
+class ParsePool
+{
+private:
+    std::size_t threadCount;
+    boost::asio::thread_pool pool;
+
+public:
+    explicit ParsePool(std::size_t threads);
+    ~ParsePool();
+    ParsePool(ParsePool const&) = delete;
+    ParsePool& operator=(ParsePool const&) = delete;
+
+    [[nodiscard]] std::size_t size() const noexcept { return threadCount; }
+
+    template <typename Function>
+    boost::asio::awaitable<std::invoke_result_t<Function&>> submit(Function fn)
+    {
+        using Result = std::invoke_result_t<Function&>;
+
+        co_return co_await boost::asio::async_initiate<decltype(boost::asio::use_awaitable), void(std::exception_ptr, Result)>(
+            [this](auto handler, Function job)
+            {
+                // Tracked so the io_context does not run out of work while a job is on a worker.
+                auto home = boost::asio::prefer(boost::asio::get_associated_executor(handler),
+                                                boost::asio::execution::outstanding_work.tracked);
+
+                boost::asio::post(pool, [handler = std::move(handler), home = std::move(home), job = std::move(job)]() mutable
+                {
+                    std::exception_ptr error;
+                    std::optional<Result> result;
+                    try
+                    {
+                        result.emplace(job());
+                    }
+                    catch (...)
+                    {
+                        error = std::current_exception();
+                        result.emplace();
+                    }
+
+                    // Complete on the awaiting coroutine's executor, not on the worker.
+                    boost::asio::post(home, [handler = std::move(handler), error, result = std::move(result)]() mutable
+                    {
+                        std::move(handler)(error, std::move(*result));
+                    });
+                });
+            },
+            boost::asio::use_awaitable, std::move(fn));
+    }
+};
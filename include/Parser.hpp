@@ -1,15 +1,33 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
+#include <atomic>
+#include <cstdint>
 #include "gtfs-realtime.pb.h"
 #include "nyct-subway.pb.h"
 #include "Types.hpp"
 #include "StopManager.hpp"
+#include "ParseArena.hpp"
+
+class StopTimes;
 
 class Parser
 {
 public:
-    static std::vector<TrainSnapshot> extractSnapshots(std::string const& data, StopManager& stops);
-    static std::unordered_set<std::string> detectTerminals(std::string const& stopTimesPath, StopManager& stops);
+    // Protobuf builds the generated FeedMessage; Wire reads only the fields we use (see WireDecoder).
+    enum class Decoder { Protobuf, Wire };
+
+    static void setDefaultDecoder(Decoder decoder);
+
+    // The decoded message and merge scratch live on arena until its next reset().
+    static std::vector<TrainSnapshot> extractSnapshots(std::string_view data, StopManager const& stops, ParseArena& arena);
+    static std::vector<TrainSnapshot> extractSnapshots(std::string_view data, StopManager const& stops, ParseArena& arena, Decoder decoder);
+    // Reads only FeedMessage.header.timestamp; returns 0 if the bytes do not start with a header.
+    static std::uint64_t peekHeaderTimestamp(std::string_view data);
+    // Stations that begin or end at least 100 scheduled trips.
+    static std::unordered_set<std::string> detectTerminals(StopTimes const& stopTimes, StopManager const& stops);
 
+private:
+    static std::atomic<Decoder> defaultDecoder;
 };
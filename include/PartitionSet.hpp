@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "sqlite3.h"
+
+// One family of per-day tables sharing a schema, e.g. Snapshots_20261018,
+// Snapshots_20261019. Rows go to the partition of their (UTC) day, a view
+// named All<family> unions every partition for queries that need the whole
+// history, and retention is a DROP TABLE per expired day instead of a DELETE.
+//
+// The single table used before partitioning (named just <family>) is kept
+// in the view as a legacy partition until it has been emptied.
+//
+// Not thread-safe: the store calls everything here under its write lock.
+class PartitionSet
+{
+public:
+    struct Partition
+    {
+        std::int64_t day = 0;
+        std::string name;
+    };
+
+    // Each index template is run ("{table}" substituted) on every new partition.
+    PartitionSet(std::string family, std::string columnsSql, std::vector<std::string> indexTemplates = {});
+    ~PartitionSet();
+    PartitionSet(PartitionSet const&) = delete;
+    PartitionSet& operator=(PartitionSet const&) = delete;
+
+    void attach(sqlite3* handle, std::int64_t today);
+    void finalizeStatements();
+
+    // Runs a "{table}" template on every existing partition; used by schema migrations.
+    bool applyToAll(std::string const& sqlTemplate);
+
+    // A cached statement for the partition holding `day`, created on first use.
+    // "{table}" in the template is replaced with the partition's name.
+    sqlite3_stmt* statement(std::int64_t day, std::size_t slot, char const* sqlTemplate);
+
+    std::string const& family() const noexcept { return familyName; }
+    std::string const& view() const noexcept { return viewName; }
+    bool hasLegacy() const noexcept { return legacy; }
+    void dropLegacy();
+
+    // A FROM source covering only the partitions from `day` on (plus legacy).
+    std::string since(std::int64_t day) const;
+    std::vector<Partition> partitionsSince(std::int64_t day) const;
+    std::string newest() const;
+
+    // Partitions for days before sealedBefore that have not been rolled up yet.
+    std::vector<Partition> pendingRollups(std::int64_t sealedBefore) const;
+    void markRolledUp(std::int64_t day);
+    std::size_t dropBefore(std::int64_t day);
+
+    static std::int64_t dayOf(std::int64_t timestamp) noexcept;
+    static std::string isoDate(std::int64_t day);    // "2026-10-18", as date(ts, 'unixepoch')
+
+private:
+    struct Entry
+    {
+        std::string name;
+        bool rolledUp = false;
+        std::vector<sqlite3_stmt*> statements;
+    };
+
+    sqlite3* db = nullptr;
+    std::string familyName;
+    std::string columns;
+    std::vector<std::string> indexes;
+    std::string viewName;
+    bool legacy = false;
+    std::map<std::int64_t, Entry> partitions;
+
+    Entry& ensure(std::int64_t day);
+    void rebuildView();
+    bool exec(std::string const& sql);
+    std::string nameFor(std::int64_t day) const;
+    static std::string substitute(std::string sql, std::string const& table);
+};
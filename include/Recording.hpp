@@ -0,0 +1,145 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "CsvReader.hpp"
+#include "FeedDelta.hpp"
+
+// Feed recordings (.rec).
+//
+// Version 1 (no header) is a bare run of frames:
+//     u64 timestamp | u32 size | size bytes of GTFS-RT protobuf
+//
+// Version 2 groups frames into compressed blocks and ends with an index:
+//     file header   magic "TPAREC\0\0" | u32 version | u64 createdAt | u16 feedCount | feedCount x (u16 length, name)
+//     block*        u32 BLOCK_MAGIC | u8 codec | u32 storedSize | u32 rawSize | u32 frameCount
+//                   | u64 firstTimestamp | u64 lastTimestamp | u32 crc32(raw) | storedSize bytes
+//       raw frame   u64 timestamp | u16 feedId | u32 size | size bytes
+//     footer        blockCount x (u64 firstTimestamp, u64 lastTimestamp, u64 offset)
+//                   | u32 blockCount | u32 crc32(entries) | u64 footerOffset | magic "TPAINDEX"
+//
+// Version 3 adds optional delta frames (see FeedDelta.hpp):
+//     file header   ... u64 createdAt | u32 keyframeInterval | u16 feedCount ...    0: no delta frames
+//     block header  ... u32 crc32(raw) | u32 resumeBlock | storedSize bytes
+//       raw frame   u64 timestamp | u16 feedId | u8 kind (0 whole, 1 delta) | u32 size | size bytes
+// A delta frame applies to the previous frame of its feed. resumeBlock is
+// the first block to decode from for every delta in this block to have its
+// keyframe; seek() starts there and rebuilds the skipped frames silently.
+//
+// Blocks are closed every BLOCK_SECONDS of recorded time, so the footer
+// locates any minute of a recording. A file whose writer died before the
+// footer is still readable: the reader rebuilds the index from the block
+// headers, and a torn last block is dropped.
+struct RecordedFrame
+{
+    static constexpr std::uint16_t UNKNOWN_FEED = 0xFFFF;    // version 1 frames carry no feed id
+
+    std::uint64_t timestamp = 0;
+    std::uint16_t feedId = UNKNOWN_FEED;
+    std::string data;
+};
+
+struct RecordingBlock
+{
+    std::uint64_t firstTimestamp = 0;
+    std::uint64_t lastTimestamp = 0;
+    std::uint64_t offset = 0;
+};
+
+class RecordingWriter
+{
+public:
+    static constexpr std::uint64_t BLOCK_SECONDS = 60;
+    static constexpr std::size_t BLOCK_BYTES = 4 << 20;    // raw bytes; closes early for very busy feeds
+
+    // keyframeInterval > 0 stores each feed whole once every that many frames and as deltas in between.
+    // Refuses (isOpen() is false) to replace a file that already exists.
+    RecordingWriter(std::string path, std::vector<std::string> const& feedNames, std::uint32_t keyframeInterval = 0);
+    ~RecordingWriter();
+    RecordingWriter(RecordingWriter const&) = delete;
+    RecordingWriter& operator=(RecordingWriter const&) = delete;
+
+    [[nodiscard]] bool isOpen() const noexcept { return out != nullptr; }
+    void write(std::uint64_t timestamp, std::uint16_t feedId, std::string_view data);
+    // Closes the open block early and forces everything written so far to disk.
+    void sync();
+    // Writes the open block and the footer; the file is complete afterwards.
+    void close();
+
+    [[nodiscard]] std::uint64_t frames() const noexcept { return totalFrames; }
+    [[nodiscard]] std::uint64_t rawBytes() const noexcept { return totalRaw; }
+    [[nodiscard]] std::uint64_t storedBytes() const noexcept { return offset; }
+    [[nodiscard]] std::string const& filePath() const noexcept { return path; }
+
+private:
+    struct FeedState
+    {
+        FeedDeltaEncoder encoder;
+        std::uint32_t untilKeyframe = 0;
+        std::uint32_t chainStart = 0;      // block holding the feed's last whole frame
+    };
+
+    std::string path;
+    std::FILE* out = nullptr;
+    std::uint32_t keyframeInterval = 0;
+    std::vector<FeedState> feedStates;
+    std::string delta;
+    std::uint64_t offset = 0;
+    std::string block;
+    std::uint32_t blockFrames = 0;
+    std::uint64_t blockFirst = 0;
+    std::uint64_t blockLast = 0;
+    std::uint32_t blockResume = 0;
+    std::vector<RecordingBlock> index;
+    std::uint64_t totalFrames = 0;
+    std::uint64_t totalRaw = 0;
+
+    void append(std::string_view bytes);
+    void flushBlock();
+};
+
+class RecordingReader
+{
+public:
+    explicit RecordingReader(std::string const& path);
+
+    // False if the file is missing or a version this build can't read.
+    [[nodiscard]] bool isOpen() const noexcept { return formatVersion != 0; }
+    [[nodiscard]] int version() const noexcept { return formatVersion; }
+    [[nodiscard]] std::uint32_t keyframeInterval() const noexcept { return keyframes; }
+    [[nodiscard]] std::vector<std::string> const& feeds() const noexcept { return feedNames; }
+    [[nodiscard]] std::vector<RecordingBlock> const& blocks() const noexcept { return index; }
+    [[nodiscard]] std::string feedName(std::uint16_t feedId) const;
+
+    // Positions the reader on the first frame recorded at or after timestamp.
+    void seek(std::uint64_t timestamp);
+    // False at the end of the recording.
+    bool next(RecordedFrame& frame);
+
+private:
+    MappedFile file;
+    std::string_view bytes;
+    int formatVersion = 0;
+    std::uint32_t keyframes = 0;
+    std::vector<std::string> feedNames;
+    std::vector<RecordingBlock> index;    // version 1: one entry per frame
+    std::size_t nextBlock = 0;
+    std::uint64_t skipBefore = 0;
+
+    std::string raw;                      // current block, decompressed
+    std::size_t rawPos = 0;
+
+    std::vector<FeedDeltaDecoder> decoders;    // by feed id
+    std::uint64_t orphanDeltas = 0;            // delta frames with no keyframe to apply to
+
+    std::size_t readHeader();
+    bool readFooter(std::size_t headerEnd);
+    void scanBlocks(std::size_t from);
+    void resetDecoders();
+    void scanFramesV1();
+    bool loadBlock(std::size_t number);
+    bool nextV1(RecordedFrame& frame);
+};
@@ -1,19 +1,38 @@
 #pragma once
 
+#include <chrono>
+#include <cstddef>
 #include <string>
-#include <fstream>
 #include <cstdint>
 
 class SQLiteStore;
 class StopManager;
+class StaticData;
+
+struct ReplaySettings
+{
+    std::uint64_t fromTimestamp = 0;    // nonzero: start at the first frame recorded at or after it
+    double speed = 1.0;                 // recorded seconds per wall-clock second; 0 replays as fast as frames decode
+    std::size_t parseThreads = 1;
+};
 
 class ReplayEngine
 {
 public:
-    static void run(std::string const& filename, SQLiteStore& db, StopManager& stops);
+    // Each frame is decoded against the static data generation current at the time; a
+    // recording from another service day rebuilds the schedule for that day. VirtualClock
+    // follows the recorded time at any speed and stays at the last frame afterwards, so
+    // the dashboard shows the end of the recording.
+    //
+    // Frames are decoded on parseThreads workers and written in recording order by the
+    // calling thread; unthrottled, up to COMMIT_SNAPSHOTS rows share one transaction.
+    // False if the recording could not be opened.
+    static bool run(std::string const& filename, SQLiteStore& db, StaticData& staticData, ReplaySettings const& settings = {});
+    // Decodes every frame with both Parser decoders, compares the snapshots and times each.
+    static bool verifyDecoders(std::string const& filename, StopManager const& stops);
 
 private:
-    static bool readChunkHeader(std::ifstream& file,std::uint64_t& timestamp, std::uint32_t& size);
-    static void syncRealtime(std::uint64_t timestamp, std::uint64_t& replayStart, std::uint64_t realStart);
-    static void processChunk(std::string& data, std::uint64_t timestamp, SQLiteStore& db, StopManager& stops);
+    static constexpr std::size_t COMMIT_SNAPSHOTS = 50000;
+
+    static void syncRealtime(std::uint64_t timestamp, std::uint64_t& replayStart, std::chrono::steady_clock::time_point realStart, double speed);
 };
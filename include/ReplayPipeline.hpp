@@ -0,0 +1,62 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Recording.hpp"
+#include "SQLiteStore.hpp"
+
+class StaticData;
+
+// Decodes a recording on several threads and hands the frames back in
+// recording order. One thread reads frames, workers run
+// Parser::extractSnapshots on them (each with its own ParseArena), and next()
+// releases them strictly by position in the file, so the single writer sees
+// every feed's snapshots in the order they were recorded. At most
+// IN_FLIGHT_PER_WORKER frames per worker are read ahead of the writer.
+class ReplayPipeline
+{
+public:
+    static constexpr std::size_t IN_FLIGHT_PER_WORKER = 8;
+
+    ReplayPipeline(RecordingReader& recording, StaticData const& staticData, std::size_t workerCount);
+    ~ReplayPipeline();
+    ReplayPipeline(ReplayPipeline const&) = delete;
+    ReplayPipeline& operator=(ReplayPipeline const&) = delete;
+
+    // Blocks for the next frame in recording order; false at the end of the recording.
+    bool next(RecordedBatch& frame);
+
+private:
+    struct Job
+    {
+        std::uint64_t sequence = 0;
+        RecordedFrame frame;
+    };
+
+    RecordingReader& recording;
+    StaticData const& staticData;
+    const std::size_t capacity;
+
+    std::mutex mutex;
+    std::condition_variable jobReady;      // workers: a job was queued, or reading ended
+    std::condition_variable spaceFree;     // reader: the writer took a frame
+    std::condition_variable frameReady;    // writer: a frame was decoded, or reading ended
+    std::deque<Job> jobs;
+    std::map<std::uint64_t, RecordedBatch> decoded;
+    std::uint64_t framesRead = 0;
+    std::uint64_t nextSequence = 0;        // next frame to hand to the writer
+    bool readerDone = false;
+    bool stopping = false;
+
+    std::vector<std::thread> workers;
+    std::thread reader;
+
+    void readFrames();
+    void decodeFrames();
+};
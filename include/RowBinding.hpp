@@ -0,0 +1,170 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include "sqlite3.h"
+#include "Types.hpp"
+
+// Compile-time map from a struct to its table columns: the column names and
+// the matching member pointers, in statement order. Binding a row expands to
+// one typed sqlite3_bind_* call per member with no runtime dispatch.
+template <typename Row>
+struct RowBinding;
+
+template <>
+struct RowBinding<TrainSnapshot>
+{
+    static constexpr std::array<std::string_view, 9> names = {
+        "timestamp", "tripId", "routeId", "trainId", "direction",
+        "isAssigned", "stopId", "currentStatus", "delay"
+    };
+
+    static constexpr auto members = std::make_tuple(
+        &TrainSnapshot::timestamp, &TrainSnapshot::tripId, &TrainSnapshot::routeId,
+        &TrainSnapshot::trainId, &TrainSnapshot::direction, &TrainSnapshot::isAssigned,
+        &TrainSnapshot::stopId, &TrainSnapshot::currentStatus, &TrainSnapshot::delay);
+
+    static_assert(names.size() == std::tuple_size_v<decltype(members)>);
+};
+
+namespace SqlBind
+{
+    template <typename>
+    inline constexpr bool unsupported = false;
+
+    // Bytes bound or read as a BLOB rather than TEXT.
+    struct Blob
+    {
+        std::string bytes;
+    };
+
+    // Text is bound SQLITE_STATIC: the caller keeps it alive until the statement
+    // has been stepped and reset, which every cached statement here guarantees.
+    template <typename T>
+    int bindValue(sqlite3_stmt* stmt, int index, T const& value)
+    {
+        if constexpr (std::is_same_v<T, bool>)
+        {
+            return sqlite3_bind_int(stmt, index, value ? 1 : 0);
+        }
+        else if constexpr (std::is_integral_v<T> && (sizeof(T) < sizeof(int) || (sizeof(T) == sizeof(int) && std::is_signed_v<T>)))
+        {
+            return sqlite3_bind_int(stmt, index, static_cast<int>(value));
+        }
+        else if constexpr (std::is_integral_v<T>)
+        {
+            return sqlite3_bind_int64(stmt, index, static_cast<sqlite3_int64>(value));
+        }
+        else if constexpr (std::is_floating_point_v<T>)
+        {
+            return sqlite3_bind_double(stmt, index, static_cast<double>(value));
+        }
+        else if constexpr (std::is_convertible_v<T const&, std::string_view>)
+        {
+            std::string_view text = value;
+            return sqlite3_bind_text(stmt, index, text.data() ? text.data() : "", static_cast<int>(text.size()), SQLITE_STATIC);
+        }
+        else if constexpr (std::is_same_v<T, Blob>)
+        {
+            return sqlite3_bind_blob(stmt, index, value.bytes.data(), static_cast<int>(value.bytes.size()), SQLITE_STATIC);
+        }
+        else
+        {
+            static_assert(unsupported<T>, "no SQLite binding for this type");
+        }
+    }
+
+    template <typename T>
+    void readValue(sqlite3_stmt* stmt, int column, T& out)
+    {
+        if constexpr (std::is_same_v<T, bool>)
+        {
+            out = sqlite3_column_int(stmt, column) != 0;
+        }
+        else if constexpr (std::is_integral_v<T> && sizeof(T) <= sizeof(int))
+        {
+            out = static_cast<T>(sqlite3_column_int(stmt, column));
+        }
+        else if constexpr (std::is_integral_v<T>)
+        {
+            out = static_cast<T>(sqlite3_column_int64(stmt, column));
+        }
+        else if constexpr (std::is_floating_point_v<T>)
+        {
+            out = static_cast<T>(sqlite3_column_double(stmt, column));
+        }
+        else if constexpr (std::is_same_v<T, std::string>)
+        {
+            const unsigned char* text = sqlite3_column_text(stmt, column);
+            out.assign(text ? reinterpret_cast<const char*>(text) : "", static_cast<std::size_t>(sqlite3_column_bytes(stmt, column)));
+        }
+        else if constexpr (std::is_same_v<T, Blob>)
+        {
+            const void* bytes = sqlite3_column_blob(stmt, column);
+            auto size = static_cast<std::size_t>(sqlite3_column_bytes(stmt, column));
+            out.bytes.assign(bytes ? static_cast<const char*>(bytes) : "", bytes ? size : 0);
+        }
+        else
+        {
+            static_assert(unsupported<T>, "no SQLite column read for this type");
+        }
+    }
+
+    // Binds parameters 1..N in order.
+    template <typename... Values>
+    void bindAll(sqlite3_stmt* stmt, Values const&... values)
+    {
+        int index = 1;
+        (bindValue(stmt, index++, values), ...);
+    }
+
+    // Reads columns 0..N-1 in order.
+    template <typename... Values>
+    void readAll(sqlite3_stmt* stmt, Values&... values)
+    {
+        int column = 0;
+        (readValue(stmt, column++, values), ...);
+    }
+
+    template <typename Row>
+    void bindRow(sqlite3_stmt* stmt, Row const& row, int first = 1)
+    {
+        std::apply([&](auto... member)
+        {
+            int index = first;
+            (bindValue(stmt, index++, row.*member), ...);
+        }, RowBinding<Row>::members);
+    }
+
+    template <typename Row>
+    void readRow(sqlite3_stmt* stmt, Row& row, int first = 0)
+    {
+        std::apply([&](auto... member)
+        {
+            int column = first;
+            (readValue(stmt, column++, row.*member), ...);
+        }, RowBinding<Row>::members);
+    }
+
+    // "INSERT INTO <table> (<columns>) VALUES (?, ...);" for a bound row type.
+    template <typename Row>
+    std::string insertSql(std::string_view table)
+    {
+        std::string columns;
+        std::string placeholders;
+        for (std::string_view name : RowBinding<Row>::names)
+        {
+            if (!columns.empty())
+            {
+                columns += ", ";
+                placeholders += ", ";
+            }
+            columns += name;
+            placeholders += '?';
+        }
+        return "INSERT INTO " + std::string(table) + " (" + columns + ") VALUES (" + placeholders + ");";
+    }
+}
@@ -1,27 +1,163 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
 #include <mutex>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
 #include "sqlite3.h"
 #include "Types.hpp"
+#include "DwellTracker.hpp"
+#include "DwellSketch.hpp"
+#include "PartitionSet.hpp"
+#include "StatementCache.hpp"
 
+class StaticData;
+
+// The snapshots decoded from one recorded feed frame.
+struct RecordedBatch
+{
+    std::uint64_t timestamp = 0;
+    std::vector<TrainSnapshot> snapshots;
+};
+
+// Result of folding Snapshots rows into Intervals, with the two layouts compared.
+// Byte sizes are -1 when SQLite was built without the dbstat table.
+struct IntervalMigrationReport
+{
+    std::int64_t migratedRows = 0;
+    std::int64_t snapshotRows = 0;
+    std::int64_t intervalRows = 0;
+    std::int64_t snapshotBytes = -1;
+    std::int64_t intervalBytes = -1;
+    std::int64_t snapshotQueryMicros = 0;
+    std::int64_t intervalQueryMicros = 0;
+    std::int64_t snapshotStalls = 0;
+    std::int64_t intervalStalls = 0;
+};
+
+// The database runs in WAL mode: one read-write connection (db, guarded by
+// writeMutex) takes every write, while queries borrow one of a pool of
+// read-only connections. Each query reads from its own WAL snapshot, so
+// dashboard reads and ingest/prune writes proceed in parallel.
+//
+// Current stalls don't touch the database at all: every write also feeds the
+// DwellTracker, which republishes the stall list once the write commits.
+//
+// Snapshots and Intervals are split into one table per UTC day (see
+// PartitionSet), read through the AllSnapshots / AllIntervals views. A day's
+// StationMetrics are rolled up once it is sealed, and retention drops whole
+// days.
+//
+// Scheduled arrivals come from the published StaticGeneration (see
+// setStaticData); when a reload swaps in a new generation, the tracker's
+// cached lookups are dropped and redone against it.
+//
+// Every stall that closes is also added to an hourly dwell sketch per
+// (station, route) in DwellSketches, so dwell percentiles over any range are
+// answered by merging a few small BLOBs instead of rescanning snapshots.
+//
+// In Intervals mode a train's state is stored once per (trip, train, stop,
+// status) run as [firstSeen, lastSeen], and each poll only extends the trip's
+// open interval until its stop or status changes.
 class SQLiteStore
 {
+public:
+    enum class StorageMode { Snapshots, Intervals };
+
 private:
     sqlite3* db;
-    sqlite3_stmt* insertStmt;
-    std::mutex mutex;
+    std::mutex writeMutex;
+    StorageMode storageMode;
+
+    PartitionSet snapshotPartitions;
+    PartitionSet intervalPartitions;
+
+    struct OpenInterval
+    {
+        sqlite3_int64 rowId = 0;
+        std::int64_t day = 0;           // partition holding the row
+        std::string trainId;
+        std::string stopId;
+        int32_t currentStatus = 0;
+        std::uint64_t lastSeen = 0;
+    };
+    using OpenIntervalMap = std::unordered_map<std::string, OpenInterval>;    // keyed by tripId
+
+    OpenIntervalMap openIntervals;
+
+    std::vector<sqlite3*> readers;
+    std::vector<sqlite3*> idleReaders;
+    std::mutex readerMutex;
+    std::condition_variable readerAvailable;
+
+    // Per-connection prepared statements; see statementsFor().
+    StatementCache writerStatements;
+    std::unordered_map<sqlite3*, StatementCache> readerStatements;
+
+    DwellTracker tracker;
+    StaticData const* staticData = nullptr;
+    std::uint64_t scheduleGeneration = 0;    // generation the tracker's cached schedule times came from
+
+    // A read-only connection borrowed from the pool for the lifetime of the lease.
+    class ReadLease
+    {
+    private:
+        SQLiteStore& store;
+        sqlite3* handle;
+
+    public:
+        explicit ReadLease(SQLiteStore& owner);
+        ~ReadLease();
+        ReadLease(ReadLease const&) = delete;
+        ReadLease& operator=(ReadLease const&) = delete;
+
+        sqlite3* get() const noexcept { return handle; }
+    };
+
+    void openReaders(std::string const& path, std::size_t count);
+    void runMigrations();
+    void checkQueryPlans();
+    bool execSql(const char* sql);
+    bool hasColumn(const char* table, const char* column);
+    void seedDwellTracker(std::uint64_t restoredUpTo);
+    void loadOpenIntervals();
+    void appendInterval(TrainSnapshot const& s, OpenIntervalMap& open);
+    void rollupSealedPartitions(std::int64_t sealedBefore);
+    void pruneLegacyTables(long long cutoffTimestamp);
+    void publishStalls();
+    void publishStalls(std::int64_t now);
+    void recordClosedDwells();
+    StatementCache& statementsFor(sqlite3* handle);
 
 public:
-    SQLiteStore(std::string const& path);
+    static constexpr std::size_t DEFAULT_READERS = 4;
+
+    // warmDwellState: DwellTracker state saved by WarmStart, or empty to rebuild from the database.
+    SQLiteStore(std::string const& path, std::size_t readerCount = DEFAULT_READERS,
+                StorageMode mode = StorageMode::Snapshots, std::string_view warmDwellState = {});
     ~SQLiteStore();
 
     void insert(TrainSnapshot const& s);
     void insertMany(std::vector<TrainSnapshot> const& snapshots);
+    void insertBatches(std::vector<std::vector<TrainSnapshot>> const& batches);
+    // Recorded frames in one transaction, with the dwell tracker advanced and published at
+    // each frame's timestamp in turn: the same result as one insertMany per frame.
+    void insertRecorded(std::vector<RecordedBatch> const& frames);
     void insertInternal(TrainSnapshot const& s);
     void pruneOldData(int daysToKeep);
-    std::vector<TrainSnapshot> getRecentStalls();
-    void importStaticSchedule(std::string const& csvPath);
-    int getScheduledTime(std::string const& tripId, std::string const& stopId);
+    // Republishes the stall list against the current clock and static data without a write,
+    // so stalls age out and a reload shows up while the feeds bring nothing new.
+    void refreshStalls();
+    std::shared_ptr<const DwellTracker::StallList> getRecentStalls() const;
+    void setStaticData(StaticData const* data);
+    // Stalls that started in [fromTs, toTs), to hour resolution; empty ids match every station/route.
+    DwellPercentiles getDwellPercentiles(std::int64_t fromTs, std::int64_t toTs,
+                                         std::string const& stationId = {}, std::string const& routeId = {});
+    IntervalMigrationReport migrateToIntervals();
+    std::string exportDwellState();
 
 };
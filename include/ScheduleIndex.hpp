@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ServiceDay.hpp"
+#include "StopTimes.hpp"
+
+class TripCalendar;
+
+// Scheduled arrivals for one service day, matched on TripKey::normalize of
+// the trip id. Only trips that run on that day are held, plus trips from the
+// day before that are still running after midnight, so keys that repeat
+// across Weekday/Saturday/Sunday service never shadow each other.
+//
+// Trip keys and stop ids are each stored once in sorted string tables, and
+// the schedule is one flat array of (key index, stop index, arrival) sorted
+// in that order: a lookup is two binary searches over the tables and one over
+// 12-byte records, with no allocation beyond normalizing the realtime trip id.
+// Immutable once built; a reload or a new service day builds a new index.
+class ScheduleIndex
+{
+private:
+    struct Entry
+    {
+        std::uint32_t key;
+        std::uint32_t stop;
+        std::int32_t arrivalSec;    // from the start of day; negative for trips carried over from the day before
+    };
+
+    ServiceDay day;
+    std::string strings;                     // every trip key, then every stop id
+    std::vector<std::uint32_t> keyBounds;    // key i is strings[keyBounds[i], keyBounds[i + 1])
+    std::vector<std::uint32_t> stopBounds;   // likewise for stop ids
+    std::vector<Entry> entries;
+
+    [[nodiscard]] std::string_view text(std::vector<std::uint32_t> const& bounds, std::size_t i) const noexcept
+    {
+        return { strings.data() + bounds[i], bounds[i + 1] - bounds[i] };
+    }
+    // Position of value in a sorted table, or -1.
+    [[nodiscard]] std::int64_t find(std::vector<std::uint32_t> const& bounds, std::string_view value) const;
+
+public:
+    // Rows without an arrival time are skipped.
+    static ScheduleIndex build(std::vector<ScheduledStop> const& rows, TripCalendar const& calendar, ServiceDay const& serviceDay);
+
+    // Scheduled arrival (epoch seconds) of the trip at the stop, taking the
+    // candidate nearest seenAt when a key runs on both days; -1 if none.
+    [[nodiscard]] std::int64_t lookup(std::string_view tripId, std::string_view stopId, std::int64_t seenAt) const;
+
+    [[nodiscard]] ServiceDay const& serviceDay() const noexcept { return day; }
+    [[nodiscard]] std::size_t size() const noexcept { return entries.size(); }
+    [[nodiscard]] std::size_t memoryBytes() const noexcept
+    {
+        return strings.capacity() + (keyBounds.capacity() + stopBounds.capacity()) * sizeof(std::uint32_t)
+             + entries.capacity() * sizeof(Entry);
+    }
+
+    void serialize(std::string& out) const;
+    bool restore(std::string_view bytes);
+};
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <string_view>
+
+// A GTFS service day in New York time. Schedule times count from "noon minus
+// 12h" on the service date (local midnight except on DST change days) and run
+// past 24:00:00 for trips that continue overnight, so the same clock reading
+// belongs to two service days for a few hours after midnight.
+struct ServiceDay
+{
+    std::int64_t localDate = 0;    // days since 1970-01-01, local calendar
+    std::int64_t start = 0;        // epoch seconds of 00:00:00 schedule time
+    int weekday = 0;               // 0 = Sunday ... 6 = Saturday
+
+    static ServiceDay ofDate(std::int64_t localDate);
+    // The service date whose local calendar day contains when.
+    static ServiceDay containing(std::time_t when);
+
+    [[nodiscard]] ServiceDay previous() const { return ofDate(localDate - 1); }
+    [[nodiscard]] ServiceDay next() const { return ofDate(localDate + 1); }
+
+    // MTA service ids name the day type (Weekday/Saturday/Sunday); any other
+    // id has no calendar here and is assumed to run every day.
+    [[nodiscard]] bool runs(std::string_view serviceId) const;
+
+    // "2026-10-18 (Sunday)"
+    [[nodiscard]] std::string label() const;
+
+    bool operator==(ServiceDay const& other) const { return localDate == other.localDate; }
+};
@@ -0,0 +1,62 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "MpscQueue.hpp"
+#include "Types.hpp"
+
+class SQLiteStore;
+
+// Snapshot figures published by the writer thread for the poll loop report.
+struct WriterStats
+{
+    std::size_t queueDepth = 0;
+    std::uint64_t commits = 0;
+    std::size_t lastCommitRows = 0;
+    std::size_t lastCommitBatches = 0;
+    std::int64_t lastCommitMicros = 0;
+};
+
+// Owns all writes to the store on one dedicated thread. Feed batches arrive
+// from any thread through a lock-free queue; everything submitted for a poll
+// cycle is committed in a single transaction when that cycle is closed, so
+// neither the io_context nor the parse workers ever wait on SQLite. A cycle
+// that brought nothing still republishes the store's stall list.
+class SnapshotWriter
+{
+private:
+    struct Job
+    {
+        enum class Kind { Batch, EndCycle, Prune, Stop };
+
+        Kind kind = Kind::Batch;
+        std::vector<TrainSnapshot> batch;
+        int daysToKeep = 0;
+    };
+
+    SQLiteStore& db;
+    MpscQueue<Job> queue;
+
+    std::atomic<std::uint64_t> commits{0};
+    std::atomic<std::size_t> lastCommitRows{0};
+    std::atomic<std::size_t> lastCommitBatches{0};
+    std::atomic<std::int64_t> lastCommitMicros{0};
+    std::thread worker;     // last, so everything above exists before run() starts
+
+    void run();
+    void commit(std::vector<std::vector<TrainSnapshot>>& pending);
+
+public:
+    explicit SnapshotWriter(SQLiteStore& store);
+    ~SnapshotWriter();
+    SnapshotWriter(SnapshotWriter const&) = delete;
+    SnapshotWriter& operator=(SnapshotWriter const&) = delete;
+
+    void submit(std::vector<TrainSnapshot> batch);
+    void endCycle();
+    void requestPrune(int daysToKeep);
+
+    [[nodiscard]] WriterStats getStats() const noexcept;
+};
@@ -0,0 +1,52 @@
+#pragma once
+#include <unordered_map>
+#include "sqlite3.h"
+
+// Prepared statements of one connection, compiled on first use and kept for
+// the life of the connection. Statements are keyed by the address of their
+// SQL text, so callers pass string constants, never a temporary buffer.
+//
+// A cache belongs to one connection and is used by one thread at a time
+// (the holder of the writer lock or of a read lease).
+class StatementCache
+{
+private:
+    sqlite3* handle;
+    std::unordered_map<const char*, sqlite3_stmt*> statements;
+
+public:
+    explicit StatementCache(sqlite3* connection = nullptr);
+    ~StatementCache();
+    StatementCache(StatementCache&& other) noexcept;
+    StatementCache& operator=(StatementCache&&) = delete;
+    StatementCache(StatementCache const&) = delete;
+    StatementCache& operator=(StatementCache const&) = delete;
+
+    void setConnection(sqlite3* connection);
+    sqlite3_stmt* get(const char* sql);
+    void clear();
+};
+
+// Borrowed cached statement; resets it and drops its bindings when the
+// borrow ends, so SQLITE_STATIC buffers are never referenced afterwards.
+class CachedStatement
+{
+private:
+    sqlite3_stmt* stmt;
+
+public:
+    explicit CachedStatement(sqlite3_stmt* statement) noexcept : stmt(statement) {}
+    ~CachedStatement()
+    {
+        if (stmt)
+        {
+            sqlite3_reset(stmt);
+            sqlite3_clear_bindings(stmt);
+        }
+    }
+    CachedStatement(CachedStatement const&) = delete;
+    CachedStatement& operator=(CachedStatement const&) = delete;
+
+    explicit operator bool() const noexcept { return stmt != nullptr; }
+    sqlite3_stmt* get() const noexcept { return stmt; }
+};
@@ -0,0 +1,77 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "ScheduleIndex.hpp"
+#include "ServiceDay.hpp"
+#include "StopManager.hpp"
+
+// Everything derived from the static GTFS files, built together and never
+// modified after it is published.
+struct StaticGeneration
+{
+    std::uint64_t number = 0;        // 1 at startup, +1 per reload
+    std::uint64_t sourceHash = 0;    // of the files it was built from
+    StopManager stops;
+    ScheduleIndex schedule;
+
+    ~StaticGeneration();
+};
+
+// Publishes the current StaticGeneration through an atomic shared_ptr.
+// Readers take current() once per unit of work (a feed decode, a page, a
+// stall publish) and keep using that generation until they let go of it; a
+// reload builds the next one on a background thread and swaps it in, and the
+// old one is freed when its last reader drops it. Nothing waits on a reload.
+//
+// The schedule only covers one service day, so crossing into the next one
+// (see ensureServiceDay and rebuildNow) is also a reload.
+class StaticData
+{
+private:
+    std::string stopsPath;
+    std::string stopTimesPath;
+    std::string tripsPath;
+    std::atomic<std::shared_ptr<const StaticGeneration>> generation;
+
+    std::mutex reloadMutex;
+    std::thread reloadThread;
+    std::atomic<bool> reloading{ false };
+
+    // The last build that came out empty, so it is not repeated until the files or the day change.
+    std::atomic<std::int64_t> emptyDate{ 0 };
+    std::atomic<std::uint64_t> emptyHash{ 0 };
+
+    void reload();
+    // Builds the generation for serviceDay and publishes it unless nothing changed or it came out empty.
+    void rebuild(ServiceDay const& serviceDay);
+
+public:
+    StaticData(std::string stopsFile, std::string stopTimesFile, std::string tripsFile);
+    ~StaticData();
+    StaticData(StaticData const&) = delete;
+    StaticData& operator=(StaticData const&) = delete;
+
+    [[nodiscard]] std::shared_ptr<const StaticGeneration> current() const;
+    void publish(std::shared_ptr<const StaticGeneration> next);
+
+    // Content hash of the source files, which keys WarmStart.
+    [[nodiscard]] std::uint64_t hashSources() const;
+    // Reads and indexes the source files for one service day, reporting time per phase.
+    [[nodiscard]] std::shared_ptr<StaticGeneration> build(std::uint64_t number, std::uint64_t sourceHash,
+                                                          ServiceDay const& serviceDay) const;
+
+    // Starts a background rebuild; false if one is already running.
+    bool requestReload();
+    // Starts a rebuild if the current schedule is for a service day other than now's.
+    // A day whose build came out empty is not retried; a reload picks up fixed files.
+    bool ensureServiceDay(std::time_t now);
+    // The same, but builds and publishes on the calling thread (after any
+    // background reload finishes), so replay sees the new day from its first
+    // frame at any speed; false if the schedule already covers now.
+    bool rebuildNow(std::time_t now);
+};
@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -12,10 +13,16 @@ private:
     std::unordered_set<std::string> terminalStations;
 
 public:
+    StopManager() = default;
     StopManager(std::string const& filepath);
     bool exists(std::string const& stopId) const;
     std::string getParent(std::string const& stopId) const;
     std::string getName(std::string const& stopId) const;
     bool isTerminal(std::string const& stopId) const;
+    std::size_t size() const { return validStops.size(); }
     void loadTerminals(const std::unordered_set<std::string>& terminals);
+
+    // Binary form of the whole index, for WarmStart.
+    void serialize(std::string& out) const;
+    bool restore(std::string_view bytes);
 };
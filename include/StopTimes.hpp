@@ -0,0 +1,46 @@
+#pragma once
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "CsvReader.hpp"
+
+// One stop_times.txt row. The ids are views into the mapped file and live as
+// long as the StopTimes that produced them.
+struct ScheduledStop
+{
+    std::string_view tripId;
+    std::string_view stopId;
+    int arrivalSec = -1;    // -1 when arrival_time is missing or malformed
+};
+
+// stop_times.txt mapped once and parsed in parallel: the body is cut into one
+// chunk per thread at line boundaries and each chunk is parsed on its own
+// thread, then the rows are joined in file order. Terminal detection and the
+// schedule import both read rows() instead of re-reading the file.
+//
+// Chunks are split on '\n', so quoted fields must not span lines (GTFS
+// stop_times never do).
+class StopTimes
+{
+private:
+    MappedFile file;
+    std::vector<ScheduledStop> scheduledStops;
+    // Fields that had "" escapes, one deque per chunk so addresses never move.
+    std::vector<std::deque<std::string>> unescaped;
+    std::size_t chunks = 0;
+
+public:
+    // threads == 0 uses one per hardware thread.
+    explicit StopTimes(std::string const& path, std::size_t threads = 0);
+    StopTimes(StopTimes const&) = delete;
+    StopTimes& operator=(StopTimes const&) = delete;
+
+    [[nodiscard]] bool isLoaded() const noexcept { return file.isOpen(); }
+    [[nodiscard]] std::vector<ScheduledStop> const& rows() const noexcept { return scheduledStops; }
+    [[nodiscard]] std::size_t chunkCount() const noexcept { return chunks; }
+
+    // "HH:MM:SS" (hours may run past 24) to seconds, or -1.
+    static int parseClock(std::string_view text);
+};
@@ -0,0 +1,26 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "ServiceDay.hpp"
+
+// service_id of every trip in trips.txt, so a schedule can be cut down to the
+// trips that run on a given service day.
+class TripCalendar
+{
+private:
+    std::vector<std::string> serviceIds;
+    std::unordered_map<std::string, std::uint16_t> serviceOfTrip;    // trip_id -> index into serviceIds
+
+public:
+    TripCalendar() = default;
+    explicit TripCalendar(std::string const& path);
+
+    // Trips missing from trips.txt have no calendar and are assumed to run.
+    [[nodiscard]] bool runsOn(std::string_view tripId, ServiceDay const& day) const;
+
+    [[nodiscard]] std::size_t size() const noexcept { return serviceOfTrip.size(); }
+};
@@ -0,0 +1,14 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+// Static and realtime trip IDs name the same trip differently:
+//   static   AFA25GEN-1038-Sunday-00_000600_1..S03R
+//   realtime                        000600_1..S03R   (sometimes without the shape suffix)
+// normalize() reduces both to origin time, route and direction ("000600_1..S"),
+// which is what ScheduleIndex is sorted on.
+class TripKey
+{
+public:
+    static std::string normalize(std::string_view tripId);
+};
@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <cstdint>
 
 // Represents the state of one train at one specific second.
@@ -15,7 +16,21 @@ struct TrainSnapshot
     int32_t currentStatus;    // 0=INCOMING, 1=STOPPED_AT, 2=IN_TRANSIT_TO
     int32_t delay = 0;
     int dwellTimeSeconds = 0; 
-    int scheduledArrivalSec = -1;
+    std::int64_t scheduledArrival = -1;    // epoch seconds of the scheduled arrival here; 0 if unscheduled
 
     
-};
\ No newline at end of file
+};
+
+// One trip's fields while a feed is being merged. The views point into the
+// bytes or message being decoded and are only valid until the parse ends.
+struct MergedTrip
+{
+    std::string_view tripId;
+    std::string_view routeId;
+    std::string_view trainId;
+    std::string_view stopId;
+    int32_t direction = 0;
+    bool isAssigned = false;
+    int32_t currentStatus = 0;
+    int32_t delay = 0;
+};
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+struct StaticGeneration;
+class SQLiteStore;
+
+// Binary snapshot of the state a restart would otherwise rebuild: the
+// StaticGeneration derived from the static GTFS files (stop index, parent
+// map, terminal set and schedule index) and the in-flight DwellTracker state.
+// The file is keyed by the generation's source hash, so a new schedule drop
+// invalidates it; it is written on a timer and at shutdown (to a temp file,
+// then renamed) and mapped on start.
+//
+// Layout: header { magic, version, sourceHash, writtenAt, payloadHash },
+// then the StopManager, ScheduleIndex and DwellTracker sections, each
+// length-prefixed.
+class WarmStart
+{
+public:
+    static constexpr std::uint32_t FORMAT_VERSION = 3;
+
+    explicit WarmStart(std::string path);
+
+    // False (and nothing changed) if the file is missing, damaged or was
+    // written from files other than those hashing to sourceHash.
+    bool load(std::uint64_t sourceHash, StaticGeneration& generation, std::string& dwellState) const;
+    bool save(StaticGeneration const& generation, SQLiteStore& db) const;
+
+private:
+    std::string path;
+};
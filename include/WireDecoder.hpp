@@ -0,0 +1,21 @@
+#pragma once
+#include <cstdint>
+#include <memory_resource>
+#include <string_view>
+#include <unordered_map>
+#include "Types.hpp"
+
+// Streaming decoder for the handful of GTFS-RT fields the ingest path uses.
+// It walks the protobuf wire format directly instead of building the
+// generated FeedMessage, skipping stop_time_update bodies once a delay has
+// been found and every field it does not need. Trips are merged with the same
+// rules as the generated-code path in Parser; views point into data.
+// Unlike ParseFromArray it does not enforce proto2 required fields.
+class WireDecoder
+{
+public:
+    using TripMap = std::pmr::unordered_map<std::string_view, MergedTrip>;
+
+    // Returns false if the bytes are not a well-formed FeedMessage.
+    static bool decode(std::string_view data, std::uint64_t& timestamp, TripMap& trips);
+};
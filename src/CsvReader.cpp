@@ -0,0 +1,244 @@
+#include <iostream>
+#include <utility>
+#include "CsvReader.hpp"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(std::string const& path)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        std::cerr << "Failed to open " << path << "\n";
+        return;
+    }
+
+    LARGE_INTEGER size{};
+    GetFileSizeEx(file, &size);
+    fileHandle = file;
+    opened = true;
+    length = static_cast<std::size_t>(size.QuadPart);
+    if (length == 0)
+        return;
+
+    mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappingHandle)
+        data = static_cast<const char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if (!data)
+    {
+        std::cerr << "Failed to map " << path << "\n";
+        release();
+    }
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        std::cerr << "Failed to open " << path << "\n";
+        return;
+    }
+
+    struct stat info{};
+    if (::fstat(fd, &info) != 0)
+    {
+        std::cerr << "Failed to stat " << path << "\n";
+        ::close(fd);
+        return;
+    }
+
+    opened = true;
+    length = static_cast<std::size_t>(info.st_size);
+    if (length > 0)
+    {
+        void* mapped = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED)
+        {
+            std::cerr << "Failed to map " << path << "\n";
+            opened = false;
+            length = 0;
+        }
+        else
+        {
+            data = static_cast<const char*>(mapped);
+            ::madvise(mapped, length, MADV_SEQUENTIAL);
+        }
+    }
+
+    // The mapping keeps the file referenced on its own.
+    ::close(fd);
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+    release();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data(std::exchange(other.data, nullptr))
+    , length(std::exchange(other.length, 0))
+    , opened(std::exchange(other.opened, false))
+#ifdef _WIN32
+    , fileHandle(std::exchange(other.fileHandle, nullptr))
+    , mappingHandle(std::exchange(other.mappingHandle, nullptr))
+#endif
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+    if (this != &other)
+    {
+        release();
+        data = std::exchange(other.data, nullptr);
+        length = std::exchange(other.length, 0);
+        opened = std::exchange(other.opened, false);
+#ifdef _WIN32
+        fileHandle = std::exchange(other.fileHandle, nullptr);
+        mappingHandle = std::exchange(other.mappingHandle, nullptr);
+#endif
+    }
+    return *this;
+}
+
+void MappedFile::release() noexcept
+{
+#ifdef _WIN32
+    if (data) UnmapViewOfFile(data);
+    if (mappingHandle) CloseHandle(mappingHandle);
+    if (fileHandle) CloseHandle(fileHandle);
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+#else
+    if (data) ::munmap(const_cast<char*>(data), length);
+#endif
+    data = nullptr;
+    length = 0;
+    opened = false;
+}
+
+CsvReader::CsvReader(std::string_view buffer)
+    : text(buffer)
+{
+    // A UTF-8 byte order mark would otherwise end up in the first column name.
+    if (text.substr(0, 3) == "\xEF\xBB\xBF")
+        pos = 3;
+}
+
+bool CsvReader::readHeader()
+{
+    if (!next())
+        return false;
+
+    headerNames.assign(fields.begin(), fields.end());
+    return true;
+}
+
+std::size_t CsvReader::column(std::string_view name, std::size_t fallback) const
+{
+    for (std::size_t i = 0; i < headerNames.size(); ++i)
+    {
+        if (headerNames[i] == name)
+            return i;
+    }
+    return fallback;
+}
+
+bool CsvReader::next()
+{
+    spans.clear();
+    fields.clear();
+    scratch.clear();
+
+    if (pos >= text.size())
+        return false;
+
+    const std::size_t end = text.size();
+    while (true)
+    {
+        if (pos < end && text[pos] == '"')
+        {
+            // Quoted: copied to scratch only once a "" escape shows up.
+            std::size_t start = ++pos;
+            std::size_t scratchStart = scratch.size();
+            bool escaped = false;
+
+            while (pos < end)
+            {
+                if (text[pos] != '"')
+                {
+                    ++pos;
+                    continue;
+                }
+                if (pos + 1 < end && text[pos + 1] == '"')
+                {
+                    scratch.append(text.data() + start, pos - start);
+                    scratch.push_back('"');
+                    escaped = true;
+                    pos += 2;
+                    start = pos;
+                    continue;
+                }
+                break;
+            }
+
+            if (escaped)
+            {
+                scratch.append(text.data() + start, pos - start);
+                spans.push_back({ scratchStart, scratch.size() - scratchStart, true });
+            }
+            else
+            {
+                spans.push_back({ start, pos - start, false });
+            }
+
+            if (pos < end)
+                ++pos;    // closing quote
+
+            // Anything between the closing quote and the delimiter is ignored.
+            while (pos < end && text[pos] != ',' && text[pos] != '\n')
+                ++pos;
+        }
+        else
+        {
+            std::size_t start = pos;
+            while (pos < end && text[pos] != ',' && text[pos] != '\n')
+                ++pos;
+
+            std::size_t stop = pos;
+            if (stop > start && text[stop - 1] == '\r' && (stop == end || text[stop] == '\n'))
+                --stop;
+            spans.push_back({ start, stop - start, false });
+        }
+
+        if (pos < end && text[pos] == ',')
+        {
+            ++pos;
+            continue;
+        }
+
+        if (pos < end)
+            ++pos;    // newline
+        break;
+    }
+
+    // Scratch no longer grows for this record, so views into it are now stable.
+    fields.reserve(spans.size());
+    for (Span const& span : spans)
+    {
+        const char* base = span.inScratch ? scratch.data() : text.data();
+        fields.emplace_back(base + span.offset, span.size);
+    }
+    return true;
+}
@@ -1,7 +1,9 @@
 #include <sstream>
+#include <cstdio>
 #include <ctime>
 #include <date/tz.h>
 #include "Types.hpp"
+#include "DwellSketch.hpp"
 #include "StopManager.hpp"
 #include "VirtualClock.hpp"
 #include "Dashboard.hpp"
@@ -9,25 +11,25 @@
 using namespace date;
 using namespace std::chrono;
 
-int Dashboard::computeNowSec()
+std::string Dashboard::formatClock(std::int64_t epochSeconds)
 {
-    auto epochNow = VirtualClock::now();
-    auto now = system_clock::from_time_t(epochNow);
+    auto when = system_clock::from_time_t(static_cast<std::time_t>(epochSeconds));
 
     auto nyc = date::locate_zone("America/New_York");
-    zoned_time nycTime{nyc, now};
+    zoned_time nycTime{nyc, when};
 
     auto local = nycTime.get_local_time();
     auto day = date::floor<date::days>(local);
     date::hh_mm_ss tod{local - day};
 
-    return tod.hours().count() * 3600
-         + tod.minutes().count() * 60
-         + tod.seconds().count();
+    char buffer[16];
+    std::snprintf(buffer, sizeof(buffer), "%02d:%02d:%02d", static_cast<int>(tod.hours().count()),
+                  static_cast<int>(tod.minutes().count()), static_cast<int>(tod.seconds().count()));
+    return buffer;
 }
 
 
-std::string Dashboard::buildHtmlHead(std::size_t stalledCount)
+std::string Dashboard::buildHtmlHead(std::size_t stalledCount, DwellPercentiles const& lastDay)
 {
     std::stringstream ss;
 
@@ -53,6 +55,12 @@ std::string Dashboard::buildHtmlHead(std::size_t stalledCount)
     ss << "<p>Status: " << stalledCount
        << " trains holding > 60s.</p>";
 
+    if (lastDay.stalls > 0)
+    {
+        ss << "<p>Last 24h: " << lastDay.stalls << " stalls, dwell p50 " << lastDay.p50
+           << "s / p95 " << lastDay.p95 << "s / p99 " << lastDay.p99 << "s.</p>";
+    }
+
     return ss.str();
 }
 
@@ -72,31 +80,14 @@ std::string Dashboard::buildTableHeader()
     return ss.str();
 }
 
-std::string Dashboard::formatLateness(TrainSnapshot const& t, int nowSec)
+std::string Dashboard::formatLateness(TrainSnapshot const& t, std::int64_t now)
 {
     std::string noSchedule = "<span style='color:#777'>No Schedule</span>";
-    if (t.scheduledArrivalSec <= 0)
+    if (t.scheduledArrival <= 0)
         return noSchedule;
 
-    int diffSeconds = nowSec - t.scheduledArrivalSec;
-
-    if (diffSeconds < -43200) diffSeconds += 86400;
-    if (diffSeconds > 43200) diffSeconds -= 86400;
-
-    int diffMinutes = diffSeconds / 60;
-    char schedBuf[16], nowBuf[16];
-
-    int sH = t.scheduledArrivalSec / 3600;
-    int sM = (t.scheduledArrivalSec % 3600) / 60;
-    int sS = t.scheduledArrivalSec % 60;
-    std::snprintf(schedBuf, sizeof(schedBuf),
-                  "%02d:%02d:%02d", sH, sM, sS);
-
-    int nH = nowSec / 3600;
-    int nM = (nowSec % 3600) / 60;
-    int nS = nowSec % 60;
-    std::snprintf(nowBuf, sizeof(nowBuf),
-                  "%02d:%02d:%02d", nH, nM, nS);
+    // Both are absolute times, so trips that run past midnight need no wraparound.
+    auto diffMinutes = (now - t.scheduledArrival) / 60;
 
     std::string color = "#888";
     if (diffMinutes > 5)       color = "#e74c3c";
@@ -107,14 +98,14 @@ std::string Dashboard::formatLateness(TrainSnapshot const& t, int nowSec)
              << "; font-weight:bold; font-size:1.2em'>"
              << (diffMinutes > 0 ? "+" : "") << diffMinutes << "m</span>"
              << "<div style='font-size:0.75em; color:#aaa; margin-top:4px;'>"
-             << "Sched: " << schedBuf << "<br>"
-             << "Now: " << nowBuf
+             << "Sched: " << formatClock(t.scheduledArrival) << "<br>"
+             << "Now: " << formatClock(now)
              << "</div>";
 
     return evidence.str();
 }
 
-std::string Dashboard::buildRow(TrainSnapshot const& t, StopManager& stops, int nowSec)
+std::string Dashboard::buildRow(TrainSnapshot const& t, StopManager const& stops, std::int64_t now)
 {
     std::string severityClass =
         (t.dwellTimeSeconds > 300) ? "severity-high" : "severity-low";
@@ -127,7 +118,7 @@ std::string Dashboard::buildRow(TrainSnapshot const& t, StopManager& stops, int
     int mins = t.dwellTimeSeconds / 60;
     int secs = t.dwellTimeSeconds % 60;
 
-    std::string latenessStr = formatLateness(t, nowSec);
+    std::string latenessStr = formatLateness(t, now);
 
     std::stringstream ss;
     ss << "<tr class='" << severityClass << "'>"
@@ -147,17 +138,19 @@ std::string Dashboard::buildRow(TrainSnapshot const& t, StopManager& stops, int
     return ss.str();
 }
 
-std::string Dashboard::generate(std::vector<TrainSnapshot> const& stalledTrains, StopManager& stops)
+std::string Dashboard::generate(std::vector<TrainSnapshot> const& stalledTrains,
+                                DwellPercentiles const& lastDay,
+                                StopManager const& stops)
 {
-    int nowSec = computeNowSec();
+    auto now = static_cast<std::int64_t>(VirtualClock::now());
 
     std::stringstream ss;
-    ss << buildHtmlHead(stalledTrains.size());
+    ss << buildHtmlHead(stalledTrains.size(), lastDay);
     ss << buildTableHeader();
 
     for (const auto& t : stalledTrains)
     {
-        ss << buildRow(t, stops, nowSec);
+        ss << buildRow(t, stops, now);
     }
 
     ss << "</tbody></table></body></html>";
@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include "DwellSketch.hpp"
+
+namespace
+{
+    void putVarint(std::string& out, std::uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    bool getVarint(std::string_view& in, std::uint64_t& value)
+    {
+        value = 0;
+        for (unsigned shift = 0; shift < 64 && !in.empty(); shift += 7)
+        {
+            auto byte = static_cast<std::uint8_t>(in.front());
+            in.remove_prefix(1);
+            value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+                return true;
+        }
+        return false;
+    }
+}
+
+std::size_t DwellSketch::indexOf(std::uint32_t value) noexcept
+{
+    if (value < SUB_BUCKETS)
+        return value;
+
+    // Power-of-two group k (>= SUB_BUCKET_BITS), then the top SUB_BUCKET_BITS bits below the leading one.
+    unsigned k = static_cast<unsigned>(std::bit_width(value)) - 1;
+    std::uint32_t sub = (value >> (k - SUB_BUCKET_BITS)) - SUB_BUCKETS;
+    return SUB_BUCKETS + (k - SUB_BUCKET_BITS) * SUB_BUCKETS + sub;
+}
+
+std::uint32_t DwellSketch::lowerBound(std::size_t index) noexcept
+{
+    if (index < SUB_BUCKETS)
+        return static_cast<std::uint32_t>(index);
+
+    std::size_t group = (index - SUB_BUCKETS) / SUB_BUCKETS;
+    std::size_t sub = (index - SUB_BUCKETS) % SUB_BUCKETS;
+    return static_cast<std::uint32_t>((SUB_BUCKETS + sub) << group);
+}
+
+std::uint32_t DwellSketch::width(std::size_t index) noexcept
+{
+    if (index < SUB_BUCKETS)
+        return 1;
+    return 1u << ((index - SUB_BUCKETS) / SUB_BUCKETS);
+}
+
+void DwellSketch::add(std::uint32_t seconds, std::uint64_t count)
+{
+    if (count == 0)
+        return;
+
+    std::size_t index = indexOf(seconds);
+    if (index >= buckets.size())
+        buckets.resize(index + 1, 0);
+
+    buckets[index] += count;
+    total += count;
+}
+
+void DwellSketch::merge(DwellSketch const& other)
+{
+    if (other.buckets.size() > buckets.size())
+        buckets.resize(other.buckets.size(), 0);
+
+    for (std::size_t i = 0; i < other.buckets.size(); ++i)
+        buckets[i] += other.buckets[i];
+    total += other.total;
+}
+
+std::uint32_t DwellSketch::quantile(double q) const
+{
+    if (total == 0)
+        return 0;
+
+    q = std::clamp(q, 0.0, 1.0);
+    auto rank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(q * static_cast<double>(total))));
+
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < buckets.size(); ++i)
+    {
+        seen += buckets[i];
+        if (seen >= rank)
+            return lowerBound(i) + (width(i) - 1) / 2;
+    }
+
+    return lowerBound(buckets.size() - 1);
+}
+
+std::string DwellSketch::serialize() const
+{
+    std::string out;
+    out.push_back(static_cast<char>(FORMAT_VERSION));
+
+    std::size_t previous = 0;
+    for (std::size_t i = 0; i < buckets.size(); ++i)
+    {
+        if (buckets[i] == 0)
+            continue;
+
+        putVarint(out, i - previous);
+        putVarint(out, buckets[i]);
+        previous = i;
+    }
+    return out;
+}
+
+bool DwellSketch::deserialize(std::string_view bytes, DwellSketch& out)
+{
+    out = DwellSketch();
+    if (bytes.empty() || static_cast<std::uint8_t>(bytes.front()) != FORMAT_VERSION)
+        return false;
+    bytes.remove_prefix(1);
+
+    // The largest index a 32-bit value can land in bounds a corrupt delta.
+    const std::size_t maxIndex = indexOf(UINT32_MAX);
+
+    std::size_t index = 0;
+    while (!bytes.empty())
+    {
+        std::uint64_t delta = 0;
+        std::uint64_t count = 0;
+        if (!getVarint(bytes, delta) || !getVarint(bytes, count))
+            return false;
+
+        index += static_cast<std::size_t>(delta);
+        if (index > maxIndex)
+            return false;
+
+        if (index >= out.buckets.size())
+            out.buckets.resize(index + 1, 0);
+        out.buckets[index] += count;
+        out.total += count;
+    }
+    return true;
+}
@@ -0,0 +1,330 @@
+#include <algorithm>
+#include <array>
+#include <string_view>
+#include "BinaryIO.hpp"
+#include "DwellTracker.hpp"
+
+namespace
+{
+    // Yards and terminals where long holds are normal operation, not stalls.
+    constexpr std::array<std::string_view, 5> EXCLUDED_STOP_PREFIXES = {
+        "701", "D43", "G05", "207", "A65"
+    };
+
+    constexpr char KEY_SEPARATOR = '\x1f';
+}
+
+DwellTracker::DwellTracker()
+    : published(std::make_shared<const StallList>())
+{
+}
+
+bool DwellTracker::isExcludedStop(std::string const& stopId)
+{
+    for (std::string_view prefix : EXCLUDED_STOP_PREFIXES)
+    {
+        if (stopId.compare(0, prefix.size(), prefix) == 0)
+            return true;
+    }
+    return false;
+}
+
+std::string DwellTracker::makeKey(std::string const& tripId, std::string const& stopId)
+{
+    std::string key;
+    key.reserve(tripId.size() + 1 + stopId.size());
+    key.append(tripId);
+    key.push_back(KEY_SEPARATOR);
+    key.append(stopId);
+    return key;
+}
+
+void DwellTracker::close(std::string const& stopId, Entry& entry)
+{
+    if (entry.closed)
+        return;
+    entry.closed = true;
+
+    auto dwell = entry.lastSeen - entry.firstSeen;
+    if (static_cast<std::int64_t>(dwell) <= MIN_DWELL_SECONDS)
+        return;
+
+    closedDwells.push_back({stopId, entry.routeId, entry.firstSeen, static_cast<std::uint32_t>(dwell)});
+}
+
+void DwellTracker::closeDeparted(TrainSnapshot const& s)
+{
+    auto open = openStops.find(s.tripId);
+    if (open == openStops.end())
+        return;
+
+    bool stillThere = s.currentStatus == 1 && s.stopId == open->second;
+    if (stillThere)
+        return;
+
+    auto it = entries.find(makeKey(s.tripId, open->second));
+    if (it != entries.end())
+    {
+        // A snapshot older than the stop's last sighting is a replay straggler, not a departure.
+        if (s.timestamp < it->second.lastSeen)
+            return;
+        close(open->second, it->second);
+    }
+    openStops.erase(open);
+}
+
+void DwellTracker::observe(TrainSnapshot const& s)
+{
+    closeDeparted(s);
+
+    if (s.currentStatus != 1 || isExcludedStop(s.stopId))
+        return;
+
+    auto [it, inserted] = entries.try_emplace(makeKey(s.tripId, s.stopId));
+    Entry& entry = it->second;
+
+    if (inserted)
+    {
+        entry.firstSeen = s.timestamp;
+        entry.lastSeen = s.timestamp;
+        entry.maxDelay = s.delay;
+    }
+    else
+    {
+        entry.firstSeen = std::min(entry.firstSeen, s.timestamp);
+        entry.maxDelay = std::max(entry.maxDelay, s.delay);
+    }
+
+    if (s.timestamp >= entry.lastSeen)
+    {
+        entry.lastSeen = s.timestamp;
+        entry.routeId = s.routeId;
+        entry.trainId = s.trainId;
+        entry.direction = s.direction;
+        entry.currentStatus = s.currentStatus;
+        entry.isAssigned = s.isAssigned;
+        openStops[s.tripId] = s.stopId;
+    }
+}
+
+void DwellTracker::seed(TrainSnapshot const& s, std::uint64_t firstSeen, std::uint64_t lastSeen, std::uint64_t lastMoving)
+{
+    if (isExcludedStop(s.stopId))
+        return;
+
+    // Seeding on top of restored state widens an entry rather than replacing it.
+    auto [it, inserted] = entries.try_emplace(makeKey(s.tripId, s.stopId));
+    Entry& entry = it->second;
+    if (inserted || lastSeen >= entry.lastSeen)
+    {
+        entry.routeId = s.routeId;
+        entry.trainId = s.trainId;
+        entry.direction = s.direction;
+        entry.currentStatus = 1;
+        entry.isAssigned = s.isAssigned;
+    }
+    entry.firstSeen = inserted ? firstSeen : std::min(entry.firstSeen, firstSeen);
+    entry.lastSeen = std::max(entry.lastSeen, lastSeen);
+    entry.maxDelay = inserted ? s.delay : std::max(entry.maxDelay, s.delay);
+
+    // Only the latest stop of each trip can still be open; the train left every other one
+    // before the restart, and those dwells are already in the sketches.
+    if (lastMoving >= entry.lastSeen)
+    {
+        entry.closed = true;
+        auto open = openStops.find(s.tripId);
+        if (open != openStops.end() && open->second == s.stopId)
+            openStops.erase(open);
+        return;
+    }
+
+    auto [open, added] = openStops.try_emplace(s.tripId, s.stopId);
+    if (!added && open->second != s.stopId)
+    {
+        auto previous = entries.find(makeKey(s.tripId, open->second));
+        if (previous == entries.end() || previous->second.lastSeen < entry.lastSeen)
+        {
+            if (previous != entries.end())
+                previous->second.closed = true;
+            open->second = s.stopId;
+        }
+        else
+        {
+            entry.closed = true;
+        }
+    }
+}
+
+void DwellTracker::publish(std::int64_t now, ScheduleLookup const& lookupSchedule)
+{
+    auto stalls = std::make_shared<StallList>();
+
+    for (auto it = entries.begin(); it != entries.end();)
+    {
+        Entry& entry = it->second;
+        auto lastSeen = static_cast<std::int64_t>(entry.lastSeen);
+
+        if (lastSeen <= now - WINDOW_SECONDS)
+        {
+            std::string const& key = it->first;
+            std::size_t split = key.find(KEY_SEPARATOR);
+            std::string tripId = key.substr(0, split);
+            std::string stopId = key.substr(split + 1);
+
+            close(stopId, entry);
+            auto open = openStops.find(tripId);
+            if (open != openStops.end() && open->second == stopId)
+                openStops.erase(open);
+
+            it = entries.erase(it);
+            continue;
+        }
+
+        auto dwell = static_cast<std::int64_t>(entry.lastSeen - entry.firstSeen);
+        if (dwell > MIN_DWELL_SECONDS && lastSeen > now - RECENT_SECONDS)
+        {
+            std::string const& key = it->first;
+            std::size_t split = key.find(KEY_SEPARATOR);
+
+            TrainSnapshot s;
+            s.tripId = key.substr(0, split);
+            s.stopId = key.substr(split + 1);
+            s.routeId = entry.routeId;
+            s.trainId = entry.trainId;
+            s.direction = entry.direction;
+            s.isAssigned = entry.isAssigned;
+            s.currentStatus = entry.currentStatus;
+            s.timestamp = entry.lastSeen;
+            s.delay = entry.maxDelay;
+            s.dwellTimeSeconds = static_cast<int>(dwell);
+
+            // Only stalls need a schedule, and each one is looked up once.
+            if (entry.scheduledArrival < 0)
+            {
+                std::int64_t arrival = lookupSchedule ? lookupSchedule(s.tripId, s.stopId, entry.firstSeen) : -1;
+                entry.scheduledArrival = arrival > 0 ? arrival : 0;
+            }
+            s.scheduledArrival = entry.scheduledArrival;
+
+            stalls->push_back(std::move(s));
+        }
+        ++it;
+    }
+
+    std::sort(stalls->begin(), stalls->end(), [](TrainSnapshot const& a, TrainSnapshot const& b)
+    {
+        return a.dwellTimeSeconds > b.dwellTimeSeconds;
+    });
+
+    published.store(std::move(stalls), std::memory_order_release);
+}
+
+void DwellTracker::forgetSchedules()
+{
+    for (auto& [key, entry] : entries)
+        entry.scheduledArrival = -1;
+}
+
+std::shared_ptr<const DwellTracker::StallList> DwellTracker::current() const
+{
+    return published.load(std::memory_order_acquire);
+}
+
+std::vector<DwellTracker::ClosedDwell> DwellTracker::takeClosed()
+{
+    std::vector<ClosedDwell> closed;
+    closed.swap(closedDwells);
+    return closed;
+}
+
+void DwellTracker::serialize(std::string& out) const
+{
+    BinaryIO::put(out, static_cast<std::uint32_t>(entries.size()));
+    for (auto const& [key, entry] : entries)
+    {
+        BinaryIO::putString(out, key);
+        BinaryIO::putString(out, entry.routeId);
+        BinaryIO::putString(out, entry.trainId);
+        BinaryIO::put(out, entry.direction);
+        BinaryIO::put(out, entry.currentStatus);
+        BinaryIO::put(out, static_cast<std::uint8_t>(entry.isAssigned));
+        BinaryIO::put(out, entry.firstSeen);
+        BinaryIO::put(out, entry.lastSeen);
+        BinaryIO::put(out, entry.maxDelay);
+        BinaryIO::put(out, entry.scheduledArrival);
+        BinaryIO::put(out, static_cast<std::uint8_t>(entry.closed));
+    }
+
+    BinaryIO::put(out, static_cast<std::uint32_t>(openStops.size()));
+    for (auto const& [tripId, stopId] : openStops)
+    {
+        BinaryIO::putString(out, tripId);
+        BinaryIO::putString(out, stopId);
+    }
+
+    BinaryIO::put(out, static_cast<std::uint32_t>(closedDwells.size()));
+    for (ClosedDwell const& dwell : closedDwells)
+    {
+        BinaryIO::putString(out, dwell.stopId);
+        BinaryIO::putString(out, dwell.routeId);
+        BinaryIO::put(out, dwell.firstSeen);
+        BinaryIO::put(out, dwell.dwellSeconds);
+    }
+}
+
+bool DwellTracker::restore(std::string_view bytes, std::uint64_t& newestSeen)
+{
+    BinaryIO::Reader reader(bytes);
+    std::unordered_map<std::string, Entry> restoredEntries;
+    std::unordered_map<std::string, std::string> restoredOpen;
+    std::vector<ClosedDwell> restoredClosed;
+    std::uint64_t newest = 0;
+
+    auto entryCount = reader.get<std::uint32_t>();
+    restoredEntries.reserve(entryCount);
+    for (std::uint32_t i = 0; i < entryCount && reader.ok(); ++i)
+    {
+        std::string key(reader.getString());
+        Entry entry;
+        entry.routeId = reader.getString();
+        entry.trainId = reader.getString();
+        entry.direction = reader.get<int32_t>();
+        entry.currentStatus = reader.get<int32_t>();
+        entry.isAssigned = reader.get<std::uint8_t>() != 0;
+        entry.firstSeen = reader.get<std::uint64_t>();
+        entry.lastSeen = reader.get<std::uint64_t>();
+        entry.maxDelay = reader.get<int32_t>();
+        entry.scheduledArrival = reader.get<std::int64_t>();
+        entry.closed = reader.get<std::uint8_t>() != 0;
+
+        newest = std::max(newest, entry.lastSeen);
+        restoredEntries.emplace(std::move(key), std::move(entry));
+    }
+
+    auto openCount = reader.get<std::uint32_t>();
+    for (std::uint32_t i = 0; i < openCount && reader.ok(); ++i)
+    {
+        std::string tripId(reader.getString());
+        restoredOpen.emplace(std::move(tripId), reader.getString());
+    }
+
+    auto closedCount = reader.get<std::uint32_t>();
+    for (std::uint32_t i = 0; i < closedCount && reader.ok(); ++i)
+    {
+        ClosedDwell dwell;
+        dwell.stopId = reader.getString();
+        dwell.routeId = reader.getString();
+        dwell.firstSeen = reader.get<std::uint64_t>();
+        dwell.dwellSeconds = reader.get<std::uint32_t>();
+        restoredClosed.push_back(std::move(dwell));
+    }
+
+    if (!reader.ok() || !reader.atEnd())
+        return false;
+
+    entries = std::move(restoredEntries);
+    openStops = std::move(restoredOpen);
+    closedDwells = std::move(restoredClosed);
+    newestSeen = newest;
+    return true;
+}
@@ -0,0 +1,28 @@
+#include <functional>
+#include "FeedChangeDetector.hpp"
+#include "Parser.hpp"
+
+bool FeedChangeDetector::isUnchanged(std::string_view body)
+{
+    std::uint64_t timestamp = Parser::peekHeaderTimestamp(body);
+
+    if (hasLast && timestamp == lastTimestamp)
+    {
+        std::size_t hash = std::hash<std::string_view>{}(body);
+        if (hash == lastHash)
+        {
+            ++unchangedSkips;
+            return true;
+        }
+        lastHash = hash;
+    }
+    else
+    {
+        lastHash = std::hash<std::string_view>{}(body);
+    }
+
+    lastTimestamp = timestamp;
+    hasLast = true;
+    ++processed;
+    return false;
+}
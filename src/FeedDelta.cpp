@@ -0,0 +1,293 @@
+#include "FeedDelta.hpp"
+
+namespace
+{
+    // Field numbers from gtfs-realtime.proto.
+    constexpr std::uint32_t FEED_ENTITY = 2;
+    constexpr std::uint32_t ENTITY_ID = 1;
+    constexpr std::uint32_t ENTITY_TRIP_UPDATE = 3;
+    constexpr std::uint32_t ENTITY_VEHICLE = 4;
+    constexpr std::uint32_t TRIP = 1;       // TripUpdate.trip and VehiclePosition.trip
+    constexpr std::uint32_t TRIP_ID = 1;
+
+    constexpr std::uint32_t LENGTH_DELIMITED = 2;
+
+    bool readVarint(std::string_view bytes, std::size_t& pos, std::uint64_t& value)
+    {
+        value = 0;
+        for (int shift = 0; shift < 64 && pos < bytes.size(); shift += 7)
+        {
+            auto byte = static_cast<std::uint8_t>(bytes[pos++]);
+            value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+                return true;
+        }
+        return false;
+    }
+
+    void putVarint(std::string& out, std::uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back(static_cast<char>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    // Steps over one field at pos; payload is set for length-delimited fields.
+    bool readField(std::string_view bytes, std::size_t& pos, std::uint32_t& number, std::uint32_t& wireType, std::string_view& payload)
+    {
+        std::uint64_t tag = 0, value = 0;
+        if (!readVarint(bytes, pos, tag) || (tag >> 3) == 0)
+            return false;
+
+        number = static_cast<std::uint32_t>(tag >> 3);
+        wireType = static_cast<std::uint32_t>(tag & 0x7);
+        switch (wireType)
+        {
+            case 0:
+                return readVarint(bytes, pos, value);
+            case 1:
+                pos += 8;
+                return pos <= bytes.size();
+            case 5:
+                pos += 4;
+                return pos <= bytes.size();
+            case LENGTH_DELIMITED:
+                if (!readVarint(bytes, pos, value) || value > bytes.size() - pos)
+                    return false;
+                payload = bytes.substr(pos, static_cast<std::size_t>(value));
+                pos += static_cast<std::size_t>(value);
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    // bounds gets the start of every top-level field, then the end of the message.
+    bool splitFields(std::string_view message, std::vector<std::uint32_t>& bounds)
+    {
+        bounds.clear();
+        std::size_t pos = 0;
+        std::uint32_t number = 0, wireType = 0;
+        std::string_view payload;
+        while (pos < message.size())
+        {
+            bounds.push_back(static_cast<std::uint32_t>(pos));
+            if (!readField(message, pos, number, wireType, payload))
+                return false;
+        }
+        bounds.push_back(static_cast<std::uint32_t>(message.size()));
+        return true;
+    }
+
+    // The first length-delimited field with this number, or empty.
+    std::string_view findField(std::string_view message, std::uint32_t wanted)
+    {
+        std::size_t pos = 0;
+        std::uint32_t number = 0, wireType = 0;
+        std::string_view payload;
+        while (pos < message.size() && readField(message, pos, number, wireType, payload))
+        {
+            if (number == wanted && wireType == LENGTH_DELIMITED)
+                return payload;
+        }
+        return {};
+    }
+}
+
+FeedDeltaEncoder::Key FeedDeltaEncoder::keyOf(std::string_view field)
+{
+    std::size_t pos = 0;
+    std::uint32_t number = 0, wireType = 0;
+    std::string_view entity;
+    if (!readField(field, pos, number, wireType, entity) || number != FEED_ENTITY || wireType != LENGTH_DELIMITED)
+        return {};
+
+    std::string_view entityId;
+    std::string_view body;
+    pos = 0;
+    while (pos < entity.size() && readField(entity, pos, number, wireType, body))
+    {
+        if (wireType != LENGTH_DELIMITED)
+            continue;
+
+        if (number == ENTITY_ID)
+            entityId = body;
+        else if (number == ENTITY_TRIP_UPDATE || number == ENTITY_VEHICLE)
+        {
+            std::string_view tripId = findField(findField(body, TRIP), TRIP_ID);
+            if (!tripId.empty())
+                return { number, tripId };
+        }
+    }
+    return entityId.empty() ? Key{} : Key{ ENTITY_ID, entityId };
+}
+
+void FeedDeltaEncoder::reset()
+{
+    previous.clear();
+    bounds.clear();
+    fields.clear();
+}
+
+void FeedDeltaEncoder::adopt(std::string_view message, std::vector<std::uint32_t>&& messageBounds)
+{
+    previous.assign(message);
+    bounds = std::move(messageBounds);
+
+    // Keys are views into previous, so they are only taken once it holds the message.
+    fields.clear();
+    for (std::uint32_t i = 0; i + 1 < bounds.size(); ++i)
+    {
+        Key key = keyOf(std::string_view(previous).substr(bounds[i], bounds[i + 1] - bounds[i]));
+        if (key.kind != 0)
+            fields.try_emplace(key, i);
+    }
+}
+
+bool FeedDeltaEncoder::encode(std::string_view message, bool keyframe, std::string& delta)
+{
+    std::vector<std::uint32_t> messageBounds;
+    if (!splitFields(message, messageBounds))
+    {
+        reset();
+        return false;
+    }
+
+    bool coded = false;
+    if (!keyframe && !bounds.empty())
+    {
+        delta.clear();
+        std::size_t literalFrom = 0, literalTo = 0;
+        std::uint32_t copyFrom = 0, copyCount = 0;
+
+        auto flushLiteral = [&]()
+        {
+            if (literalTo > literalFrom)
+            {
+                putVarint(delta, static_cast<std::uint64_t>(literalTo - literalFrom) << 1);
+                delta.append(message.substr(literalFrom, literalTo - literalFrom));
+            }
+            literalFrom = literalTo;
+        };
+        auto flushCopy = [&]()
+        {
+            if (copyCount > 0)
+            {
+                putVarint(delta, (static_cast<std::uint64_t>(copyCount) << 1) | 1);
+                putVarint(delta, copyFrom);
+            }
+            copyCount = 0;
+        };
+
+        for (std::size_t i = 0; i + 1 < messageBounds.size(); ++i)
+        {
+            std::string_view field = message.substr(messageBounds[i], messageBounds[i + 1] - messageBounds[i]);
+
+            auto match = fields.end();
+            Key key = keyOf(field);
+            if (key.kind != 0)
+            {
+                match = fields.find(key);
+                if (match != fields.end() &&
+                    std::string_view(previous).substr(bounds[match->second], bounds[match->second + 1] - bounds[match->second]) != field)
+                    match = fields.end();
+            }
+
+            if (match == fields.end())
+            {
+                flushCopy();
+                if (literalTo == literalFrom)
+                    literalFrom = messageBounds[i];
+                literalTo = messageBounds[i + 1];
+                continue;
+            }
+
+            flushLiteral();
+            if (copyCount > 0 && copyFrom + copyCount == match->second)
+            {
+                ++copyCount;
+                continue;
+            }
+            flushCopy();
+            copyFrom = match->second;
+            copyCount = 1;
+        }
+        flushLiteral();
+        flushCopy();
+
+        coded = delta.size() < message.size();
+    }
+
+    adopt(message, std::move(messageBounds));
+    return coded;
+}
+
+bool FeedDeltaDecoder::setBase(std::string_view message)
+{
+    current.assign(message);
+    if (splitFields(current, bounds))
+        return true;
+
+    reset();
+    return false;
+}
+
+void FeedDeltaDecoder::reset()
+{
+    current.clear();
+    bounds.clear();
+}
+
+bool FeedDeltaDecoder::apply(std::string_view delta, std::string& message)
+{
+    if (bounds.empty())
+        return false;
+
+    scratch.clear();
+    std::size_t pos = 0;
+    const std::size_t fieldCount = bounds.size() - 1;
+    while (pos < delta.size())
+    {
+        std::uint64_t op = 0;
+        if (!readVarint(delta, pos, op))
+        {
+            reset();
+            return false;
+        }
+
+        if (op & 1)
+        {
+            std::uint64_t count = op >> 1, from = 0;
+            if (!readVarint(delta, pos, from) || from > fieldCount || count > fieldCount - from)
+            {
+                reset();
+                return false;
+            }
+            scratch.append(current, bounds[from], bounds[from + count] - bounds[from]);
+        }
+        else
+        {
+            std::uint64_t length = op >> 1;
+            if (length > delta.size() - pos)
+            {
+                reset();
+                return false;
+            }
+            scratch.append(delta.substr(pos, static_cast<std::size_t>(length)));
+            pos += static_cast<std::size_t>(length);
+        }
+    }
+
+    if (!splitFields(scratch, scratchBounds))
+    {
+        reset();
+        return false;
+    }
+    current.swap(scratch);
+    bounds.swap(scratchBounds);
+    message.assign(current);
+    return true;
+}
@@ -0,0 +1,185 @@
+#include <filesystem>
+#include <iostream>
+#include "FeedRecorder.hpp"
+
+FeedRecorder::FeedRecorder(std::string path, std::vector<std::string> feeds, RecordingPolicy rotation)
+    : basePath(std::move(path))
+    , feedNames(std::move(feeds))
+    , policy(rotation)
+    , worker([this]() { run(); })
+{
+}
+
+FeedRecorder::~FeedRecorder()
+{
+    Job stop;
+    stop.kind = Job::Kind::Stop;
+    queue.push(std::move(stop));
+
+    if (worker.joinable())
+        worker.join();
+}
+
+bool FeedRecorder::record(std::uint64_t timestamp, std::uint16_t feedId, std::string_view data)
+{
+    // Only the poll loop records, so the check and the add below do not race each other.
+    if (queuedBytes.load(std::memory_order_relaxed) + data.size() > QUEUE_BYTES)
+    {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    queuedBytes.fetch_add(data.size(), std::memory_order_relaxed);
+
+    Job job;
+    job.timestamp = timestamp;
+    job.feedId = feedId;
+    job.data.assign(data);
+    queue.push(std::move(job));
+    return true;
+}
+
+void FeedRecorder::requestSync()
+{
+    Job job;
+    job.kind = Job::Kind::Sync;
+    queue.push(std::move(job));
+}
+
+RecorderStats FeedRecorder::getStats() const noexcept
+{
+    RecorderStats stats;
+    stats.queueDepth           = queue.size();
+    stats.frames               = frames.load(std::memory_order_relaxed);
+    stats.droppedFrames        = dropped.load(std::memory_order_relaxed);
+    stats.files                = files.load(std::memory_order_relaxed);
+    stats.rawBytesPerSecond    = rawRate.load(std::memory_order_relaxed);
+    stats.storedBytesPerSecond = storedRate.load(std::memory_order_relaxed);
+    return stats;
+}
+
+std::string FeedRecorder::pathOf(std::uint64_t number) const
+{
+    if (number <= 1)
+        return basePath;
+
+    std::filesystem::path path(basePath);
+    std::filesystem::path name = path.stem();
+    name += '-';
+    name += std::to_string(number);
+    name += path.extension();
+    return (path.parent_path() / name).string();
+}
+
+void FeedRecorder::openFile(std::uint64_t timestamp)
+{
+    std::error_code ec;
+    std::filesystem::path parent = std::filesystem::path(basePath).parent_path();
+    if (!parent.empty())
+        std::filesystem::create_directories(parent, ec);
+
+    std::uint64_t number = nextNumber;
+    while (std::filesystem::exists(pathOf(number), ec))
+        ++number;
+    nextNumber = number + 1;
+    std::string path = pathOf(number);
+
+    bool first = files.fetch_add(1, std::memory_order_relaxed) == 0;
+    file = std::make_unique<RecordingWriter>(path, feedNames, policy.keyframeInterval);
+    fileHour = timestamp / 3600;
+    if (!file->isOpen())
+        return;
+
+    if (first && number > 1)
+        std::cout << "[System] " << basePath << " already exists; recording to " << path << std::endl;
+    else if (!first)
+        std::cout << "[System] Recording continues in " << path << std::endl;
+}
+
+void FeedRecorder::closeFile()
+{
+    if (!file)
+        return;
+
+    file->close();
+    closedRaw += file->rawBytes();
+    closedStored += file->storedBytes();
+    file.reset();
+}
+
+void FeedRecorder::writeFrame(Job const& job)
+{
+    if (file)
+    {
+        // The size check lags by up to one block, which is still in memory until it closes.
+        bool full = policy.maxFileBytes > 0 && file->storedBytes() >= policy.maxFileBytes;
+        bool newHour = policy.hourly && job.timestamp / 3600 != fileHour;
+        if (full || newHour)
+        {
+            sync();
+            closeFile();
+        }
+    }
+    if (!file)
+        openFile(job.timestamp);
+
+    if (!file->isOpen())
+    {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    file->write(job.timestamp, job.feedId, job.data);
+    frames.fetch_add(1, std::memory_order_relaxed);
+}
+
+void FeedRecorder::sync()
+{
+    auto now = std::chrono::steady_clock::now();
+    auto elapsedMillis = std::chrono::duration_cast<std::chrono::milliseconds>(now - lastSync).count();
+    lastSync = now;
+
+    std::uint64_t raw = closedRaw, stored = closedStored;
+    if (file)
+    {
+        file->sync();
+        raw += file->rawBytes();
+        stored += file->storedBytes();
+    }
+
+    if (elapsedMillis > 0)
+    {
+        rawRate.store((raw - lastRaw) * 1000 / elapsedMillis, std::memory_order_relaxed);
+        storedRate.store((stored - lastStored) * 1000 / elapsedMillis, std::memory_order_relaxed);
+    }
+    lastRaw = raw;
+    lastStored = stored;
+}
+
+void FeedRecorder::run()
+{
+    for (;;)
+    {
+        std::uint64_t seen = queue.pushCount();
+        std::optional<Job> job = queue.pop();
+        if (!job)
+        {
+            queue.waitForPushAfter(seen);
+            continue;
+        }
+
+        switch (job->kind)
+        {
+            case Job::Kind::Frame:
+                writeFrame(*job);
+                queuedBytes.fetch_sub(job->data.size(), std::memory_order_relaxed);
+                break;
+
+            case Job::Kind::Sync:
+                sync();
+                break;
+
+            case Job::Kind::Stop:
+                closeFile();
+                return;
+        }
+    }
+}
@@ -16,25 +16,45 @@ MtaClient::MtaClient(boost::asio::io_context& ioc, std::string key)
 
         sslContext.set_default_verify_paths();
         sslContext.set_verify_mode(boost::asio::ssl::verify_none);
+
+        // Client-side session cache so a reconnect can resume instead of doing a full handshake.
+        SSL_CTX_set_session_cache_mode(sslContext.native_handle(), SSL_SESS_CACHE_CLIENT);
     }
 
+MtaClient::~MtaClient()
+{
+    if (tlsSession) SSL_SESSION_free(tlsSession);
+}
 
-void MtaClient::configureTlsStream(boost::beast::ssl_stream<boost::beast::tcp_stream>& stream)
+
+void MtaClient::configureTlsStream(TlsStream& stream)
 {
     if (!SSL_set_tlsext_host_name(stream.native_handle(), ConfigurationManager::MTA_HOST.c_str()))
     {
         throw boost::beast::system_error(boost::system::error_code(static_cast<int>(::ERR_get_error()), boost::asio::error::get_ssl_category()),"Failed to set SNI");
     }
     stream.set_verify_callback(boost::asio::ssl::host_name_verification(ConfigurationManager::MTA_HOST));
+
+    if (tlsSession)
+        SSL_set_session(stream.native_handle(), tlsSession);
 }
 
-boost::asio::awaitable<boost::asio::ip::basic_resolver_results<boost::asio::ip::tcp>> MtaClient::resolve(boost::asio::ip::tcp::resolver& resolver, boost::beast::ssl_stream<boost::beast::tcp_stream>& stream)
+boost::asio::awaitable<boost::asio::ip::basic_resolver_results<boost::asio::ip::tcp>> MtaClient::resolve()
 {
+    auto now = std::chrono::steady_clock::now();
+    if (!cachedEndpoints.empty() && now < dnsExpiry)
+        co_return cachedEndpoints;
+
+    boost::asio::ip::tcp::resolver resolver(ioContext);
     boost::asio::ip::tcp::resolver::results_type results = co_await resolver.async_resolve(ConfigurationManager::MTA_HOST, ConfigurationManager::MTA_PORT,boost::asio::use_awaitable);
+    ++stats.dnsLookups;
+
+    cachedEndpoints = results;
+    dnsExpiry = std::chrono::steady_clock::now() + DNS_TTL;
     co_return results;
 }   
 
-boost::asio::awaitable<void> MtaClient::connect(boost::asio::ip::tcp::resolver::results_type results, boost::beast::ssl_stream<boost::beast::tcp_stream>& stream)
+boost::asio::awaitable<void> MtaClient::connect(boost::asio::ip::tcp::resolver::results_type results, TlsStream& stream)
 {
     co_await boost::beast::get_lowest_layer(stream).async_connect(results, boost::asio::use_awaitable);
 
@@ -43,51 +63,229 @@ boost::asio::awaitable<void> MtaClient::connect(boost::asio::ip::tcp::resolver::
     co_return;
 }
 
+boost::asio::awaitable<std::unique_ptr<MtaClient::Connection>> MtaClient::acquireConnection(std::chrono::steady_clock::time_point deadline, bool freshOnly)
+{
+    auto now = std::chrono::steady_clock::now();
+
+    // Most recently used first; anything idle for too long has likely been closed by the server.
+    while (!freshOnly && !idleConnections.empty())
+    {
+        std::unique_ptr<Connection> connection = std::move(idleConnections.back());
+        idleConnections.pop_back();
+
+        if (now - connection->lastUsed < MAX_IDLE_AGE)
+        {
+            ++stats.reusedConnections;
+            co_return connection;
+        }
+
+        boost::asio::co_spawn(ioContext, retireConnection(std::move(connection)), boost::asio::detached);
+    }
+
+    auto executor = co_await boost::asio::this_coro::executor;
+    auto connection = std::make_unique<Connection>(executor, sslContext);
+    configureTlsStream(connection->stream);
+
+    boost::asio::ip::tcp::resolver::results_type results = co_await resolve();
+
+    // One deadline for connect, handshake, write and read; beast closes the socket when it passes.
+    boost::beast::get_lowest_layer(connection->stream).expires_at(deadline);
+    try
+    {
+        co_await connect(results, connection->stream);
+    }
+    catch (boost::system::system_error const&)
+    {
+        // The cached address may be what went wrong; look it up again next time.
+        cachedEndpoints = {};
+        throw;
+    }
+
+    ++stats.newConnections;
+    if (SSL_session_reused(connection->stream.native_handle()))
+        ++stats.resumedSessions;
+
+    co_return connection;
+}
+
+void MtaClient::releaseConnection(std::unique_ptr<Connection> connection)
+{
+    connection->lastUsed = std::chrono::steady_clock::now();
+
+    if (idleConnections.size() >= MAX_IDLE_CONNECTIONS)
+    {
+        boost::asio::co_spawn(ioContext, retireConnection(std::move(connection)), boost::asio::detached);
+        return;
+    }
+
+    idleConnections.push_back(std::move(connection));
+}
+
+void MtaClient::retireIdleSince(std::chrono::steady_clock::time_point lastUsed)
+{
+    // Sockets idle at least as long as one the server just dropped were most likely dropped too.
+    auto kept = idleConnections.begin();
+    for (auto it = idleConnections.begin(); it != idleConnections.end(); ++it)
+    {
+        if ((*it)->lastUsed <= lastUsed)
+            boost::asio::co_spawn(ioContext, retireConnection(std::move(*it)), boost::asio::detached);
+        else
+            *kept++ = std::move(*it);
+    }
+    idleConnections.erase(kept, idleConnections.end());
+}
+
+void MtaClient::rememberTlsSession(TlsStream& stream)
+{
+    // Called after the first response so TLS 1.3 session tickets have already arrived.
+    SSL_SESSION* session = SSL_get1_session(stream.native_handle());
+    if (!session)
+        return;
+
+    if (tlsSession) SSL_SESSION_free(tlsSession);
+    tlsSession = session;
+}
+
+void MtaClient::rememberValidators(std::string const& target, boost::beast::http::response<boost::beast::http::string_body> const& response)
+{
+    auto etag = response.find(boost::beast::http::field::etag);
+    auto lastModified = response.find(boost::beast::http::field::last_modified);
+
+    if (etag == response.end() && lastModified == response.end())
+    {
+        validators.erase(target);
+        return;
+    }
+
+    Validators& v = validators[target];
+    v.etag         = (etag != response.end()) ? std::string(etag->value()) : std::string();
+    v.lastModified = (lastModified != response.end()) ? std::string(lastModified->value()) : std::string();
+}
+
 boost::beast::http::request<boost::beast::http::string_body> MtaClient::buildGetRequest(std::string const& target) const
 {
     boost::beast::http::request<boost::beast::http::string_body> request(boost::beast::http::verb::get, target, 11);
     request.set(boost::beast::http::field::host, ConfigurationManager::MTA_HOST);
     request.set(boost::beast::http::field::user_agent, BOOST_BEAST_VERSION_STRING);
     request.set("X-API-Key", this->apiKey);
+    request.keep_alive(true);
+
+    auto it = validators.find(target);
+    if (it != validators.end())
+    {
+        if (!it->second.etag.empty())
+            request.set(boost::beast::http::field::if_none_match, it->second.etag);
+        if (!it->second.lastModified.empty())
+            request.set(boost::beast::http::field::if_modified_since, it->second.lastModified);
+    }
 
     return request;
 
 }
 
-boost::asio::awaitable<void> MtaClient::sendRequest(boost::beast::ssl_stream<boost::beast::tcp_stream>& stream, boost::beast::http::request<boost::beast::http::string_body> const& request)
+boost::asio::awaitable<void> MtaClient::sendRequest(TlsStream& stream, boost::beast::http::request<boost::beast::http::string_body> const& request)
 {
     co_await boost::beast::http::async_write(stream, request, boost::asio::use_awaitable);
 }
 
-boost::asio::awaitable<boost::beast::http::response<boost::beast::http::string_body>> MtaClient::readResponse(boost::beast::ssl_stream<boost::beast::tcp_stream>& stream)
+boost::asio::awaitable<void> MtaClient::readResponse(Connection& connection, boost::beast::http::response<boost::beast::http::string_body>& response)
 {
-    boost::beast::http::response<boost::beast::http::string_body> response;
-    boost::beast::flat_buffer buffer;
-    co_await boost::beast::http::async_read(stream, buffer, response, boost::asio::use_awaitable);
-    co_return response;
+    co_await boost::beast::http::async_read(connection.stream, connection.buffer, response, boost::asio::use_awaitable);
 }   
 
-
-boost::asio::awaitable<std::string> MtaClient::fetch(std::string target)
+bool MtaClient::isStaleConnectionError(boost::system::error_code const& ec)
 {
-    auto executor = co_await boost::asio::this_coro::executor;
-    boost::asio::ip::tcp::resolver resolver(ioContext);
-    boost::beast::ssl_stream<boost::beast::tcp_stream> stream(executor, sslContext);
+    return ec == boost::beast::http::error::end_of_stream
+        || ec == boost::asio::error::eof
+        || ec == boost::asio::error::connection_reset
+        || ec == boost::asio::error::connection_aborted
+        || ec == boost::asio::error::broken_pipe
+        || ec == boost::asio::ssl::error::stream_truncated;
+}
+
 
-    configureTlsStream(stream);
-    boost::asio::ip::tcp::resolver::results_type results =  co_await resolve(resolver, stream);
-    co_await connect(results, stream);
+boost::asio::awaitable<FetchResult> MtaClient::fetch(std::string target, std::string& bodyBuffer, std::chrono::steady_clock::duration timeout)
+{
+    auto deadline = std::chrono::steady_clock::now() + timeout;
     boost::beast::http::request<boost::beast::http::string_body> request = buildGetRequest(target);
-    co_await sendRequest(stream, request);
-    boost::beast::http::response<boost::beast::http::string_body> response = co_await this-> readResponse(stream);
-    co_return response.body();
+
+    for (int attempt = 0; ; ++attempt)
+    {
+        std::unique_ptr<Connection> connection = co_await acquireConnection(deadline, attempt > 0);
+        bool reused = connection->requestsServed > 0;
+        boost::beast::get_lowest_layer(connection->stream).expires_at(deadline);
+
+        // The response body borrows the caller's buffer so its capacity carries over between polls.
+        boost::beast::http::response<boost::beast::http::string_body> response;
+        response.body() = std::move(bodyBuffer);
+        response.body().clear();
+        std::size_t capacityBefore = response.body().capacity();
+
+        try
+        {
+            co_await sendRequest(connection->stream, request);
+            co_await this->readResponse(*connection, response);
+        }
+        catch (boost::system::system_error const& e)
+        {
+            bodyBuffer = std::move(response.body());
+
+            // A pooled socket the server already closed fails on first use; retry once on a
+            // new connection rather than another pooled one that may have gone stale with it.
+            if (reused && attempt == 0 && isStaleConnectionError(e.code()))
+            {
+                ++stats.staleReconnects;
+                retireIdleSince(connection->lastUsed);
+                continue;
+            }
+            throw;
+        }
+
+        bodyBuffer = std::move(response.body());
+
+        ++stats.requests;
+        if (connection->requestsServed++ == 0)
+            rememberTlsSession(connection->stream);
+
+        if (response.keep_alive())
+        {
+            boost::beast::get_lowest_layer(connection->stream).expires_never();
+            releaseConnection(std::move(connection));
+        }
+        else
+        {
+            boost::asio::co_spawn(ioContext, retireConnection(std::move(connection)), boost::asio::detached);
+        }
+
+        FetchResult result;
+        if (response.result() == boost::beast::http::status::not_modified)
+        {
+            ++stats.notModified;
+            result.notModified = true;
+            co_return result;
+        }
+
+        if (response.result() == boost::beast::http::status::ok)
+            rememberValidators(target, response);
+
+        result.body           = bodyBuffer;
+        result.bytesCopied    = bodyBuffer.size();
+        result.bytesAllocated = bodyBuffer.capacity() > capacityBefore ? bodyBuffer.capacity() - capacityBefore : 0;
+        co_return result;
+    }
 }
 
 
 
-boost::asio::awaitable<void> MtaClient::shutdownStream(boost::beast::ssl_stream<boost::beast::tcp_stream>& stream)
+boost::asio::awaitable<void> MtaClient::shutdownStream(TlsStream& stream)
 {
     boost::system::error_code ec;
     co_await stream.async_shutdown(boost::asio::redirect_error(boost::asio::use_awaitable, ec));
     co_return;
 }
+
+boost::asio::awaitable<void> MtaClient::retireConnection(std::unique_ptr<Connection> connection)
+{
+    boost::beast::get_lowest_layer(connection->stream).expires_after(std::chrono::seconds(2));
+    co_await shutdownStream(connection->stream);
+}
@@ -0,0 +1,38 @@
+#include <algorithm>
+#include "ParseArena.hpp"
+
+ParseArena::ParseArena()
+    : messageBlock(INITIAL_MESSAGE_BYTES)
+    , scratchBlock(std::make_unique<std::byte[]>(SCRATCH_BYTES))
+    , scratchResource(scratchBlock.get(), SCRATCH_BYTES)
+{
+    rebuildMessageArena();
+}
+
+void ParseArena::rebuildMessageArena()
+{
+    google::protobuf::ArenaOptions options;
+    options.initial_block = messageBlock.data();
+    options.initial_block_size = messageBlock.size();
+    messageArena = std::make_unique<google::protobuf::Arena>(options);
+}
+
+void ParseArena::reset()
+{
+    std::size_t used = static_cast<std::size_t>(messageArena->SpaceAllocated());
+    highWater = std::max(highWater, used);
+
+    if (highWater > messageBlock.size())
+    {
+        // Grow the first block past the peak (with some headroom) so the next cycle fits in it.
+        messageArena.reset();
+        messageBlock.assign(highWater + highWater / 4, 0);
+        rebuildMessageArena();
+    }
+    else
+    {
+        messageArena->Reset();
+    }
+
+    scratchResource.release();
+}
@@ -0,0 +1,15 @@
+#include <algorithm>
+#include <iostream>
+#include "ParsePool.hpp"
+
+ParsePool::ParsePool(std::size_t threads)
+    : threadCount(std::max<std::size_t>(threads, 1))
+    , pool(threadCount)
+{
+    std::cout << "[System] Parse pool started with " << threadCount << " worker threads." << std::endl;
+}
+
+ParsePool::~ParsePool()
+{
+    pool.join();
+}
@@ -1,154 +1,200 @@
-#include <sstream>
-#include <fstream>
+#include <algorithm>
+#include <iterator>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
 #include "Parser.hpp"
 #include "StopManager.hpp"
+#include "WireDecoder.hpp"
+#include "StopTimes.hpp"
     
-std::vector<TrainSnapshot> Parser::extractSnapshots(std::string const& data, StopManager& stops)
-{
-    if (data.empty() || data[0] == '<')
-        return {};
+std::atomic<Parser::Decoder> Parser::defaultDecoder{Parser::Decoder::Protobuf};
 
-    transit_realtime::FeedMessage feed;
-    if (!feed.ParseFromString(data))
-        return {};
+namespace
+{
+    void applyNyctDescriptor(transit_realtime::TripDescriptor const& trip, MergedTrip& m)
+    {
+        if (!trip.HasExtension(transit_realtime::nyct_trip_descriptor))
+            return;
 
-    uint64_t ts = feed.header().timestamp();
-    std::unordered_map<std::string, TrainSnapshot> mergeMap;
+        const auto& ext = trip.GetExtension(transit_realtime::nyct_trip_descriptor);
+        m.trainId    = ext.train_id();
+        m.direction  = ext.direction();
+        m.isAssigned = ext.is_assigned();
+    }
 
-    for (const auto& entity : feed.entity())
+    // Generated-code path: full FeedMessage on the arena, merged by trip ID.
+    // The map's views point into that message, so nothing is copied until a
+    // trip survives the stop filters.
+    bool mergeWithProtobuf(std::string_view data, ParseArena& arena, uint64_t& ts, WireDecoder::TripMap& mergeMap)
     {
-        std::string tripId;
+        auto* feed = google::protobuf::Arena::CreateMessage<transit_realtime::FeedMessage>(arena.protobuf());
+        if (!feed->ParseFromArray(data.data(), static_cast<int>(data.size())))
+            return false;
 
-        if (entity.has_trip_update())
-            tripId = entity.trip_update().trip().trip_id();
-        else if (entity.has_vehicle())
-            tripId = entity.vehicle().trip().trip_id();
-        else
-            continue;
-
-        TrainSnapshot& snap = mergeMap[tripId];
-        snap.tripId    = tripId;
-        snap.timestamp = ts;
+        ts = feed->header().timestamp();
+        mergeMap.reserve(static_cast<std::size_t>(feed->entity_size()));
 
-        if (entity.has_trip_update())
+        for (const auto& entity : feed->entity())
         {
-            const auto& tu = entity.trip_update();
-            snap.routeId = tu.trip().route_id();
+            std::string_view tripId;
+
+            if (entity.has_trip_update())
+                tripId = entity.trip_update().trip().trip_id();
+            else if (entity.has_vehicle())
+                tripId = entity.vehicle().trip().trip_id();
+            else
+                continue;
+
+            MergedTrip& snap = mergeMap[tripId];
+            snap.tripId = tripId;
 
-            for (int i = 0; i < tu.stop_time_update_size(); ++i)
+            if (entity.has_trip_update())
             {
-                const auto& st = tu.stop_time_update(i);
-                if (st.has_arrival() && st.arrival().has_delay())
-                {
-                    snap.delay = st.arrival().delay();
-                    break;
-                }
-                if (st.has_departure() && st.departure().has_delay())
+                const auto& tu = entity.trip_update();
+                snap.routeId = tu.trip().route_id();
+
+                for (int i = 0; i < tu.stop_time_update_size(); ++i)
                 {
-                    snap.delay = st.departure().delay();
-                    break;
+                    const auto& st = tu.stop_time_update(i);
+                    if (st.has_arrival() && st.arrival().has_delay())
+                    {
+                        snap.delay = st.arrival().delay();
+                        break;
+                    }
+                    if (st.has_departure() && st.departure().has_delay())
+                    {
+                        snap.delay = st.departure().delay();
+                        break;
+                    }
                 }
-            }
 
-            if (tu.trip().HasExtension(transit_realtime::nyct_trip_descriptor))
-            {
-                const auto& ext =
-                    tu.trip().GetExtension(transit_realtime::nyct_trip_descriptor);
-                snap.trainId    = ext.train_id();
-                snap.direction  = ext.direction();
-                snap.isAssigned = ext.is_assigned();
+                applyNyctDescriptor(tu.trip(), snap);
             }
-        }
 
-        if (entity.has_vehicle())
-        {
-            const auto& v = entity.vehicle();
-            snap.routeId       = v.trip().route_id();
-            snap.stopId        = v.stop_id();         
-            snap.currentStatus = v.current_status();
-
-            if (v.trip().HasExtension(transit_realtime::nyct_trip_descriptor))
+            if (entity.has_vehicle())
             {
-                const auto& ext =
-                    v.trip().GetExtension(transit_realtime::nyct_trip_descriptor);
-                snap.trainId    = ext.train_id();
-                snap.direction  = ext.direction();
-                snap.isAssigned = ext.is_assigned();
+                const auto& v = entity.vehicle();
+                snap.routeId       = v.trip().route_id();
+                snap.stopId        = v.stop_id();         
+                snap.currentStatus = v.current_status();
+
+                applyNyctDescriptor(v.trip(), snap);
             }
         }
+
+        return true;
     }
+}
+
+void Parser::setDefaultDecoder(Decoder decoder)
+{
+    defaultDecoder.store(decoder, std::memory_order_relaxed);
+}
+
+std::vector<TrainSnapshot> Parser::extractSnapshots(std::string_view data, StopManager const& stops, ParseArena& arena)
+{
+    return extractSnapshots(data, stops, arena, defaultDecoder.load(std::memory_order_relaxed));
+}
+
+std::vector<TrainSnapshot> Parser::extractSnapshots(std::string_view data, StopManager const& stops, ParseArena& arena, Decoder decoder)
+{
+    if (data.empty() || data[0] == '<')
+        return {};
+
+    uint64_t ts = 0;
+    WireDecoder::TripMap mergeMap(arena.scratch());
+
+    bool decoded = (decoder == Decoder::Wire)
+        ? WireDecoder::decode(data, ts, mergeMap)
+        : mergeWithProtobuf(data, arena, ts, mergeMap);
+    if (!decoded)
+        return {};
 
     std::vector<TrainSnapshot> out;
     out.reserve(mergeMap.size());
 
     for (auto& kv : mergeMap)
     {
-        TrainSnapshot& s = kv.second;
-
-        if (s.stopId.empty())          continue;
-        if (!stops.exists(s.stopId))   continue;
-        if (stops.isTerminal(s.stopId)) continue;
-
-        out.push_back(std::move(s));
+        MergedTrip const& m = kv.second;
+
+        if (m.stopId.empty())          continue;
+
+        std::string stopId(m.stopId);
+        if (!stops.exists(stopId))   continue;
+        if (stops.isTerminal(stopId)) continue;
+
+        TrainSnapshot& s = out.emplace_back();
+        s.tripId        = m.tripId;
+        s.routeId       = m.routeId;
+        s.trainId       = m.trainId;
+        s.stopId        = std::move(stopId);
+        s.direction     = m.direction;
+        s.isAssigned    = m.isAssigned;
+        s.currentStatus = m.currentStatus;
+        s.delay         = m.delay;
+        s.timestamp     = ts;
     }
 
     return out;
 }
 
 
-std::unordered_set<std::string> Parser::detectTerminals(std::string const& stopTimesPath, StopManager& stops)
+std::uint64_t Parser::peekHeaderTimestamp(std::string_view data)
 {
-    std::unordered_map<std::string, int> terminalCount;
-    std::ifstream f(stopTimesPath);
-    if (!f.is_open())
+    google::protobuf::io::CodedInputStream input(reinterpret_cast<const std::uint8_t*>(data.data()), static_cast<int>(data.size()));
+
+    // FeedMessage.header is field 1 and is serialized first, so this normally stops at the first tag.
+    for (std::uint32_t tag = input.ReadTag(); tag != 0; tag = input.ReadTag())
     {
-        std::cerr << "Failed to open " << stopTimesPath << "\n";
-        return {};
-    }
+        if (tag != ((1u << 3) | 2u))
+        {
+            if (!google::protobuf::internal::WireFormatLite::SkipField(&input, tag))
+                return 0;
+            continue;
+        }
 
+        std::uint32_t length = 0;
+        if (!input.ReadVarint32(&length))
+            return 0;
 
-    std::string line;
-    std::getline(f, line); 
+        transit_realtime::FeedHeader header;
+        std::size_t offset = static_cast<std::size_t>(input.CurrentPosition());
+        if (offset + length > data.size() || !header.ParseFromArray(data.data() + offset, static_cast<int>(length)))
+            return 0;
 
-    std::string prevTrip;
-    std::string firstParent;
-    std::string lastParent;
+        return header.timestamp();
+    }
 
-    while (std::getline(f, line))
-    {
-        std::stringstream ss(line);
+    return 0;
+}
 
-        std::string trip_id, stop_id, arrival, depart, seqStr;
-        std::getline(ss, trip_id, ',');
-        std::getline(ss, stop_id, ',');
-        std::getline(ss, arrival, ',');
-        std::getline(ss, depart, ',');
-        std::getline(ss, seqStr, ',');
 
-        if (!stops.exists(stop_id))
-            continue;
+std::unordered_set<std::string> Parser::detectTerminals(StopTimes const& stopTimes, StopManager const& stops)
+{
+    std::unordered_map<std::string, int> terminalCount;
+    auto const& rows = stopTimes.rows();
+
+    // Rows of a trip are contiguous; only the first and last stop we know of count, so
+    // each trip's ends are found from both sides instead of resolving every row.
+    auto known = [&stops](ScheduledStop const& row) { return stops.exists(std::string(row.stopId)); };
 
-        std::string parent = stops.getParent(stop_id);
+    for (std::size_t begin = 0; begin < rows.size();)
+    {
+        std::size_t end = begin + 1;
+        while (end < rows.size() && rows[end].tripId == rows[begin].tripId)
+            ++end;
 
-        if (trip_id != prevTrip)
+        auto first = std::find_if(rows.begin() + begin, rows.begin() + end, known);
+        if (first != rows.begin() + end)
         {
-            if (!prevTrip.empty() && !firstParent.empty() && !lastParent.empty()) {
-                terminalCount[firstParent]++;
-                terminalCount[lastParent]++;
-            }
+            auto last = std::find_if(std::make_reverse_iterator(rows.begin() + end),
+                                     std::make_reverse_iterator(first), known);
 
-            prevTrip = trip_id;
-            firstParent = parent;
-            lastParent = parent;
-        }
-        else {
-            lastParent = parent;
+            terminalCount[stops.getParent(std::string(first->stopId))]++;
+            terminalCount[stops.getParent(std::string(last->stopId))]++;
         }
-    }
 
-    if (!firstParent.empty() && !lastParent.empty()) {
-        terminalCount[firstParent]++;
-        terminalCount[lastParent]++;
+        begin = end;
     }
 
     std::unordered_set<std::string> terminals;
@@ -0,0 +1,296 @@
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include "PartitionSet.hpp"
+
+PartitionSet::PartitionSet(std::string family, std::string columnsSql, std::vector<std::string> indexTemplates)
+    : familyName(std::move(family))
+    , columns(std::move(columnsSql))
+    , indexes(std::move(indexTemplates))
+    , viewName("All" + familyName)
+{
+}
+
+std::string PartitionSet::substitute(std::string sql, std::string const& table)
+{
+    for (std::size_t pos; (pos = sql.find("{table}")) != std::string::npos;)
+        sql.replace(pos, 7, table);
+    return sql;
+}
+
+bool PartitionSet::applyToAll(std::string const& sqlTemplate)
+{
+    for (auto const& [day, entry] : partitions)
+    {
+        if (!exec(substitute(sqlTemplate, entry.name)))
+            return false;
+    }
+    return true;
+}
+
+PartitionSet::~PartitionSet()
+{
+    finalizeStatements();
+}
+
+void PartitionSet::finalizeStatements()
+{
+    for (auto& [day, entry] : partitions)
+    {
+        for (sqlite3_stmt* stmt : entry.statements)
+            if (stmt) sqlite3_finalize(stmt);
+        entry.statements.clear();
+    }
+}
+
+std::int64_t PartitionSet::dayOf(std::int64_t timestamp) noexcept
+{
+    return timestamp >= 0 ? timestamp / 86400 : (timestamp - 86399) / 86400;
+}
+
+std::string PartitionSet::isoDate(std::int64_t day)
+{
+    std::chrono::year_month_day ymd{std::chrono::sys_days{std::chrono::days{day}}};
+
+    char text[16];
+    std::snprintf(text, sizeof(text), "%04d-%02u-%02u",
+                  static_cast<int>(ymd.year()),
+                  static_cast<unsigned>(ymd.month()),
+                  static_cast<unsigned>(ymd.day()));
+    return text;
+}
+
+std::string PartitionSet::nameFor(std::int64_t day) const
+{
+    std::string suffix = isoDate(day);
+    std::erase(suffix, '-');
+    return familyName + "_" + suffix;
+}
+
+bool PartitionSet::exec(std::string const& sql)
+{
+    char* errMsg = nullptr;
+    if (sqlite3_exec(db, sql.c_str(), nullptr, nullptr, &errMsg) != SQLITE_OK)
+    {
+        std::cerr << "Partition statement failed (" << familyName << "): "
+                  << (errMsg ? errMsg : "unknown error") << "\n";
+        if (errMsg) sqlite3_free(errMsg);
+        return false;
+    }
+    return true;
+}
+
+void PartitionSet::attach(sqlite3* handle, std::int64_t today)
+{
+    db = handle;
+
+    exec("CREATE TABLE IF NOT EXISTS Partitions ("
+         "  name TEXT PRIMARY KEY, "
+         "  family TEXT NOT NULL, "
+         "  day INTEGER NOT NULL, "
+         "  rolledUp INTEGER NOT NULL DEFAULT 0"
+         ");");
+
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, "SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = ?;", -1, &stmt, nullptr) == SQLITE_OK)
+    {
+        sqlite3_bind_text(stmt, 1, familyName.c_str(), -1, SQLITE_TRANSIENT);
+        legacy = sqlite3_step(stmt) == SQLITE_ROW;
+    }
+    sqlite3_finalize(stmt);
+
+    // Catalog rows whose table was dropped by hand are ignored.
+    const char* loadSql =
+        "SELECT P.day, P.name, P.rolledUp FROM Partitions P "
+        "JOIN sqlite_master M ON M.type = 'table' AND M.name = P.name "
+        "WHERE P.family = ?;";
+
+    stmt = nullptr;
+    if (sqlite3_prepare_v2(db, loadSql, -1, &stmt, nullptr) == SQLITE_OK)
+    {
+        sqlite3_bind_text(stmt, 1, familyName.c_str(), -1, SQLITE_TRANSIENT);
+        while (sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            Entry& entry = partitions[sqlite3_column_int64(stmt, 0)];
+            entry.name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+            entry.rolledUp = sqlite3_column_int(stmt, 2) != 0;
+        }
+    }
+    sqlite3_finalize(stmt);
+
+    ensure(today);
+    rebuildView();
+}
+
+PartitionSet::Entry& PartitionSet::ensure(std::int64_t day)
+{
+    auto it = partitions.find(day);
+    if (it != partitions.end())
+        return it->second;
+
+    Entry& entry = partitions[day];
+    entry.name = nameFor(day);
+
+    exec("CREATE TABLE IF NOT EXISTS " + entry.name + " (" + columns + ");");
+    for (auto const& index : indexes)
+        exec(substitute(index, entry.name));
+
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, "INSERT OR IGNORE INTO Partitions (name, family, day) VALUES (?, ?, ?);", -1, &stmt, nullptr) == SQLITE_OK)
+    {
+        sqlite3_bind_text(stmt, 1, entry.name.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 2, familyName.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int64(stmt, 3, day);
+        sqlite3_step(stmt);
+    }
+    sqlite3_finalize(stmt);
+
+    rebuildView();
+    return entry;
+}
+
+void PartitionSet::rebuildView()
+{
+    std::string sql = "DROP VIEW IF EXISTS " + viewName + "; CREATE VIEW " + viewName + " AS ";
+
+    bool first = true;
+    auto add = [&](std::string const& table)
+    {
+        sql += (first ? "SELECT * FROM " : " UNION ALL SELECT * FROM ") + table;
+        first = false;
+    };
+
+    if (legacy)
+        add(familyName);
+    for (auto const& [day, entry] : partitions)
+        add(entry.name);
+
+    if (first)
+    {
+        exec("DROP VIEW IF EXISTS " + viewName + ";");
+        return;
+    }
+
+    exec(sql + ";");
+}
+
+sqlite3_stmt* PartitionSet::statement(std::int64_t day, std::size_t slot, char const* sqlTemplate)
+{
+    Entry& entry = ensure(day);
+    if (slot >= entry.statements.size())
+        entry.statements.resize(slot + 1, nullptr);
+
+    if (!entry.statements[slot])
+    {
+        std::string sql = substitute(sqlTemplate, entry.name);
+
+        if (sqlite3_prepare_v3(db, sql.c_str(), -1, SQLITE_PREPARE_PERSISTENT, &entry.statements[slot], nullptr) != SQLITE_OK)
+        {
+            std::cerr << "Failed to prepare statement for " << entry.name << ": "
+                      << sqlite3_errmsg(db) << "\n";
+            entry.statements[slot] = nullptr;
+        }
+    }
+
+    return entry.statements[slot];
+}
+
+void PartitionSet::dropLegacy()
+{
+    if (!legacy)
+        return;
+
+    exec("DROP TABLE IF EXISTS " + familyName + ";");
+    legacy = false;
+    rebuildView();
+}
+
+std::vector<PartitionSet::Partition> PartitionSet::partitionsSince(std::int64_t day) const
+{
+    std::vector<Partition> result;
+    for (auto it = partitions.lower_bound(day); it != partitions.end(); ++it)
+        result.push_back({it->first, it->second.name});
+    return result;
+}
+
+std::string PartitionSet::newest() const
+{
+    return partitions.empty() ? std::string() : partitions.rbegin()->second.name;
+}
+
+std::string PartitionSet::since(std::int64_t day) const
+{
+    std::vector<std::string> tables;
+    if (legacy)
+        tables.push_back(familyName);
+    for (auto const& partition : partitionsSince(day))
+        tables.push_back(partition.name);
+
+    if (tables.empty())
+        return "(SELECT * FROM " + viewName + " WHERE 0)";
+    if (tables.size() == 1)
+        return tables.front();
+
+    std::string source = "(";
+    for (std::size_t i = 0; i < tables.size(); ++i)
+        source += (i ? " UNION ALL SELECT * FROM " : "SELECT * FROM ") + tables[i];
+    return source + ")";
+}
+
+std::vector<PartitionSet::Partition> PartitionSet::pendingRollups(std::int64_t sealedBefore) const
+{
+    std::vector<Partition> result;
+    for (auto const& [day, entry] : partitions)
+    {
+        if (day >= sealedBefore)
+            break;
+        if (!entry.rolledUp)
+            result.push_back({day, entry.name});
+    }
+    return result;
+}
+
+void PartitionSet::markRolledUp(std::int64_t day)
+{
+    auto it = partitions.find(day);
+    if (it == partitions.end())
+        return;
+
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, "UPDATE Partitions SET rolledUp = 1 WHERE name = ?;", -1, &stmt, nullptr) == SQLITE_OK)
+    {
+        sqlite3_bind_text(stmt, 1, it->second.name.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_step(stmt);
+    }
+    sqlite3_finalize(stmt);
+
+    it->second.rolledUp = true;
+}
+
+std::size_t PartitionSet::dropBefore(std::int64_t day)
+{
+    std::size_t dropped = 0;
+
+    for (auto it = partitions.begin(); it != partitions.end() && it->first < day;)
+    {
+        for (sqlite3_stmt* stmt : it->second.statements)
+            if (stmt) sqlite3_finalize(stmt);
+
+        exec("DROP TABLE IF EXISTS " + it->second.name + ";");
+
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v2(db, "DELETE FROM Partitions WHERE name = ?;", -1, &stmt, nullptr) == SQLITE_OK)
+        {
+            sqlite3_bind_text(stmt, 1, it->second.name.c_str(), -1, SQLITE_TRANSIENT);
+            sqlite3_step(stmt);
+        }
+        sqlite3_finalize(stmt);
+
+        it = partitions.erase(it);
+        ++dropped;
+    }
+
+    if (dropped > 0)
+        rebuildView();
+    return dropped;
+}
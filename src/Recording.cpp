@@ -0,0 +1,529 @@
+#include <algorithm>
+#include <ctime>
+#include <iostream>
+#include <zlib.h>
+#include "BinaryIO.hpp"
+#include "Recording.hpp"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+    constexpr char FILE_MAGIC[8] = { 'T', 'P', 'A', 'R', 'E', 'C', '\0', '\0' };
+    constexpr char INDEX_MAGIC[8] = { 'T', 'P', 'A', 'I', 'N', 'D', 'E', 'X' };
+    constexpr std::uint32_t FORMAT_VERSION = 3;
+    constexpr std::uint32_t OLDEST_BLOCK_VERSION = 2;
+    constexpr std::uint32_t BLOCK_MAGIC = 0x4B4C4254;    // "TBLK" on little-endian hosts
+
+    constexpr std::size_t BLOCK_HEADER_BYTES_V2 = 4 + 1 + 3 * 4 + 2 * 8 + 4;
+    constexpr std::size_t BLOCK_HEADER_BYTES = BLOCK_HEADER_BYTES_V2 + 4;
+    constexpr std::size_t V1_FRAME_HEADER_BYTES = 8 + 4;
+    constexpr std::size_t INDEX_ENTRY_BYTES = 3 * 8;
+    constexpr std::size_t TRAILER_BYTES = 4 + 4 + 8 + sizeof(INDEX_MAGIC);
+
+    enum Codec : std::uint8_t { Stored = 0, Deflate = 1 };
+    enum FrameKind : std::uint8_t { Whole = 0, Delta = 1 };
+
+    struct BlockHeader
+    {
+        std::uint32_t magic = 0;
+        std::uint8_t codec = Stored;
+        std::uint32_t storedSize = 0;
+        std::uint32_t rawSize = 0;
+        std::uint32_t frameCount = 0;
+        std::uint64_t firstTimestamp = 0;
+        std::uint64_t lastTimestamp = 0;
+        std::uint32_t crc = 0;
+        std::uint32_t resumeBlock = 0;
+    };
+
+    std::size_t blockHeaderBytes(int version)
+    {
+        return version >= 3 ? BLOCK_HEADER_BYTES : BLOCK_HEADER_BYTES_V2;
+    }
+
+    BlockHeader readBlockHeader(BinaryIO::Reader& reader, int version)
+    {
+        BlockHeader header;
+        header.magic          = reader.get<std::uint32_t>();
+        header.codec          = reader.get<std::uint8_t>();
+        header.storedSize     = reader.get<std::uint32_t>();
+        header.rawSize        = reader.get<std::uint32_t>();
+        header.frameCount     = reader.get<std::uint32_t>();
+        header.firstTimestamp = reader.get<std::uint64_t>();
+        header.lastTimestamp  = reader.get<std::uint64_t>();
+        header.crc            = reader.get<std::uint32_t>();
+        if (version >= 3)
+            header.resumeBlock = reader.get<std::uint32_t>();
+        return header;
+    }
+
+    std::uint32_t checksum(std::string_view bytes)
+    {
+        return static_cast<std::uint32_t>(crc32(0L, reinterpret_cast<const Bytef*>(bytes.data()), static_cast<uInt>(bytes.size())));
+    }
+}
+
+RecordingWriter::RecordingWriter(std::string file, std::vector<std::string> const& feedNames, std::uint32_t keyframes)
+    : path(std::move(file))
+    , out(std::fopen(path.c_str(), "wbx"))    // never replaces an existing recording
+    , keyframeInterval(keyframes)
+{
+    if (!out)
+    {
+        std::cerr << "Failed to open recording " << path << "\n";
+        return;
+    }
+
+    std::string header(FILE_MAGIC, sizeof(FILE_MAGIC));
+    BinaryIO::put(header, FORMAT_VERSION);
+    BinaryIO::put(header, static_cast<std::uint64_t>(std::time(nullptr)));
+    BinaryIO::put(header, keyframeInterval);
+    BinaryIO::put(header, static_cast<std::uint16_t>(feedNames.size()));
+    for (std::string const& name : feedNames)
+    {
+        BinaryIO::put(header, static_cast<std::uint16_t>(name.size()));
+        header.append(name);
+    }
+    append(header);
+    if (out)
+        std::fflush(out);
+}
+
+RecordingWriter::~RecordingWriter()
+{
+    close();
+}
+
+void RecordingWriter::write(std::uint64_t timestamp, std::uint16_t feedId, std::string_view data)
+{
+    if (!out)
+        return;
+
+    FrameKind kind = Whole;
+    std::string_view payload = data;
+    FeedState* feed = nullptr;
+    if (keyframeInterval > 0)
+    {
+        if (feedId >= feedStates.size())
+            feedStates.resize(static_cast<std::size_t>(feedId) + 1);
+        feed = &feedStates[feedId];
+        if (feed->encoder.encode(data, feed->untilKeyframe == 0, delta))
+        {
+            kind = Delta;
+            payload = delta;
+        }
+    }
+
+    if (blockFrames > 0 && (timestamp >= blockFirst + BLOCK_SECONDS || block.size() + payload.size() > BLOCK_BYTES))
+        flushBlock();
+
+    const auto blockNumber = static_cast<std::uint32_t>(index.size());
+    if (blockFrames == 0)
+    {
+        blockFirst = timestamp;
+        blockLast = timestamp;
+        blockResume = blockNumber;
+    }
+    blockFirst = std::min(blockFirst, timestamp);
+    blockLast = std::max(blockLast, timestamp);
+
+    if (feed && kind == Delta)
+    {
+        blockResume = std::min(blockResume, feed->chainStart);
+        --feed->untilKeyframe;
+    }
+    else if (feed)
+    {
+        feed->chainStart = blockNumber;
+        feed->untilKeyframe = keyframeInterval - 1;
+    }
+
+    BinaryIO::put(block, timestamp);
+    BinaryIO::put(block, feedId);
+    BinaryIO::put(block, static_cast<std::uint8_t>(kind));
+    BinaryIO::put(block, static_cast<std::uint32_t>(payload.size()));
+    block.append(payload);
+
+    ++blockFrames;
+    ++totalFrames;
+    totalRaw += data.size();
+}
+
+void RecordingWriter::flushBlock()
+{
+    if (blockFrames == 0)
+        return;
+
+    // Level 1: GTFS-RT protobuf still shrinks several times over, at a fraction of the CPU of higher levels.
+    uLongf storedSize = compressBound(static_cast<uLong>(block.size()));
+    std::string stored(storedSize, '\0');
+    Codec codec = Deflate;
+    if (compress2(reinterpret_cast<Bytef*>(stored.data()), &storedSize,
+                  reinterpret_cast<const Bytef*>(block.data()), static_cast<uLong>(block.size()), Z_BEST_SPEED) == Z_OK &&
+        storedSize < block.size())
+    {
+        stored.resize(storedSize);
+    }
+    else
+    {
+        codec = Stored;
+        stored = block;
+    }
+
+    std::string header;
+    BinaryIO::put(header, BLOCK_MAGIC);
+    BinaryIO::put(header, static_cast<std::uint8_t>(codec));
+    BinaryIO::put(header, static_cast<std::uint32_t>(stored.size()));
+    BinaryIO::put(header, static_cast<std::uint32_t>(block.size()));
+    BinaryIO::put(header, blockFrames);
+    BinaryIO::put(header, blockFirst);
+    BinaryIO::put(header, blockLast);
+    BinaryIO::put(header, checksum(block));
+    BinaryIO::put(header, blockResume);
+
+    index.push_back({ blockFirst, blockLast, offset });
+    append(header);
+    append(stored);
+    if (out)
+        std::fflush(out);
+
+    block.clear();
+    blockFrames = 0;
+}
+
+void RecordingWriter::sync()
+{
+    if (!out)
+        return;
+
+    flushBlock();
+    if (!out)
+        return;
+#ifdef _WIN32
+    _commit(_fileno(out));
+#else
+    ::fsync(::fileno(out));
+#endif
+}
+
+void RecordingWriter::close()
+{
+    if (!out)
+        return;
+
+    flushBlock();
+
+    std::string footer;
+    for (RecordingBlock const& entry : index)
+    {
+        BinaryIO::put(footer, entry.firstTimestamp);
+        BinaryIO::put(footer, entry.lastTimestamp);
+        BinaryIO::put(footer, entry.offset);
+    }
+    std::uint64_t footerOffset = offset;
+    std::uint32_t footerCrc = checksum(footer);
+    BinaryIO::put(footer, static_cast<std::uint32_t>(index.size()));
+    BinaryIO::put(footer, footerCrc);
+    BinaryIO::put(footer, footerOffset);
+    footer.append(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    append(footer);
+    if (!out)
+        return;
+    std::fclose(out);
+    out = nullptr;
+
+    std::cout << "[System] Closed recording " << path << ": " << totalFrames << " frames, "
+              << totalRaw / 1024 << " KiB of feed data in " << offset / 1024 << " KiB." << std::endl;
+}
+
+void RecordingWriter::append(std::string_view bytes)
+{
+    if (!out)
+        return;
+
+    if (std::fwrite(bytes.data(), 1, bytes.size(), out) != bytes.size())
+    {
+        // Keep what is already on disk readable; the reader rebuilds the index from the blocks.
+        std::cerr << "Failed to write recording " << path << "; recording stopped.\n";
+        std::fclose(out);
+        out = nullptr;
+        return;
+    }
+    offset += bytes.size();
+}
+
+RecordingReader::RecordingReader(std::string const& path)
+    : file(path)
+{
+    if (!file.isOpen())
+        return;
+    bytes = file.view();
+
+    if (bytes.substr(0, sizeof(FILE_MAGIC)) != std::string_view(FILE_MAGIC, sizeof(FILE_MAGIC)))
+    {
+        // Version 1 files start straight with a frame.
+        formatVersion = 1;
+        scanFramesV1();
+        return;
+    }
+
+    std::size_t headerEnd = readHeader();
+    if (formatVersion == 0)
+    {
+        std::cerr << "Recording " << path << " has an unsupported format version.\n";
+        return;
+    }
+
+    if (!readFooter(headerEnd))
+    {
+        scanBlocks(headerEnd);
+        std::cout << "[System] Recording " << path << " has no index (its writer stopped early); rebuilt it from "
+                  << index.size() << " blocks." << std::endl;
+    }
+}
+
+std::size_t RecordingReader::readHeader()
+{
+    BinaryIO::Reader reader(bytes.substr(sizeof(FILE_MAGIC)));
+    auto version = reader.get<std::uint32_t>();
+    reader.get<std::uint64_t>();    // createdAt
+    if (version >= 3)
+        keyframes = reader.get<std::uint32_t>();
+    auto feedCount = reader.get<std::uint16_t>();
+    for (std::uint16_t i = 0; i < feedCount && reader.ok(); ++i)
+        feedNames.emplace_back(reader.getBytes(reader.get<std::uint16_t>()));
+
+    if (reader.ok() && version >= OLDEST_BLOCK_VERSION && version <= FORMAT_VERSION)
+        formatVersion = static_cast<int>(version);
+    return bytes.size() - reader.remaining();
+}
+
+bool RecordingReader::readFooter(std::size_t headerEnd)
+{
+    if (bytes.size() < headerEnd + TRAILER_BYTES)
+        return false;
+
+    BinaryIO::Reader trailer(bytes.substr(bytes.size() - TRAILER_BYTES));
+    auto count = trailer.get<std::uint32_t>();
+    auto footerCrc = trailer.get<std::uint32_t>();
+    auto footerOffset = trailer.get<std::uint64_t>();
+    std::string_view magic = trailer.getBytes(sizeof(INDEX_MAGIC));
+
+    if (magic != std::string_view(INDEX_MAGIC, sizeof(INDEX_MAGIC)) || footerOffset < headerEnd ||
+        footerOffset + static_cast<std::uint64_t>(count) * INDEX_ENTRY_BYTES + TRAILER_BYTES != bytes.size())
+        return false;
+
+    std::string_view entries = bytes.substr(footerOffset, static_cast<std::size_t>(count) * INDEX_ENTRY_BYTES);
+    if (checksum(entries) != footerCrc)
+        return false;
+
+    BinaryIO::Reader reader(entries);
+    std::vector<RecordingBlock> blocks(count);
+    for (RecordingBlock& block : blocks)
+    {
+        block.firstTimestamp = reader.get<std::uint64_t>();
+        block.lastTimestamp = reader.get<std::uint64_t>();
+        block.offset = reader.get<std::uint64_t>();
+        if (block.offset < headerEnd || block.offset + blockHeaderBytes(formatVersion) > footerOffset)
+            return false;
+    }
+
+    index = std::move(blocks);
+    return true;
+}
+
+void RecordingReader::scanBlocks(std::size_t from)
+{
+    const std::size_t headerBytes = blockHeaderBytes(formatVersion);
+    std::size_t pos = from;
+    while (pos + headerBytes <= bytes.size())
+    {
+        BinaryIO::Reader reader(bytes.substr(pos, headerBytes));
+        BlockHeader header = readBlockHeader(reader, formatVersion);
+        if (header.magic != BLOCK_MAGIC || pos + headerBytes + header.storedSize > bytes.size())
+            break;
+
+        index.push_back({ header.firstTimestamp, header.lastTimestamp, pos });
+        pos += headerBytes + header.storedSize;
+    }
+}
+
+void RecordingReader::scanFramesV1()
+{
+    std::size_t pos = 0;
+    while (pos + V1_FRAME_HEADER_BYTES <= bytes.size())
+    {
+        BinaryIO::Reader reader(bytes.substr(pos, V1_FRAME_HEADER_BYTES));
+        auto timestamp = reader.get<std::uint64_t>();
+        auto size = reader.get<std::uint32_t>();
+        if (pos + V1_FRAME_HEADER_BYTES + size > bytes.size())
+            break;
+
+        index.push_back({ timestamp, timestamp, pos });
+        pos += V1_FRAME_HEADER_BYTES + size;
+    }
+}
+
+std::string RecordingReader::feedName(std::uint16_t feedId) const
+{
+    return feedId < feedNames.size() ? feedNames[feedId] : std::string("unknown feed");
+}
+
+void RecordingReader::seek(std::uint64_t timestamp)
+{
+    skipBefore = timestamp;
+    raw.clear();
+    rawPos = 0;
+
+    auto first = std::partition_point(index.begin(), index.end(), [timestamp](RecordingBlock const& block)
+    {
+        return block.lastTimestamp < timestamp;
+    });
+    nextBlock = static_cast<std::size_t>(first - index.begin());
+
+    // Deltas in the target block may lean on keyframes in earlier ones.
+    if (keyframes > 0 && nextBlock < index.size())
+    {
+        BinaryIO::Reader reader(bytes.substr(index[nextBlock].offset));
+        BlockHeader header = readBlockHeader(reader, formatVersion);
+        if (reader.ok() && header.magic == BLOCK_MAGIC && header.resumeBlock < nextBlock)
+            nextBlock = header.resumeBlock;
+    }
+    resetDecoders();
+}
+
+void RecordingReader::resetDecoders()
+{
+    for (FeedDeltaDecoder& decoder : decoders)
+        decoder.reset();
+}
+
+bool RecordingReader::loadBlock(std::size_t number)
+{
+    raw.clear();
+    rawPos = 0;
+
+    std::size_t pos = index[number].offset;
+    BinaryIO::Reader reader(bytes.substr(pos));
+    BlockHeader header = readBlockHeader(reader, formatVersion);
+    std::string_view stored = reader.getBytes(header.storedSize);
+    if (!reader.ok() || header.magic != BLOCK_MAGIC)
+    {
+        std::cerr << "Recording block at offset " << pos << " is unreadable; skipping it.\n";
+        return false;
+    }
+
+    bool decoded = false;
+    if (header.codec == Stored)
+    {
+        raw.assign(stored);
+        decoded = raw.size() == header.rawSize;
+    }
+    else if (header.codec == Deflate)
+    {
+        raw.resize(header.rawSize);
+        uLongf rawSize = header.rawSize;
+        decoded = uncompress(reinterpret_cast<Bytef*>(raw.data()), &rawSize,
+                             reinterpret_cast<const Bytef*>(stored.data()), static_cast<uLong>(stored.size())) == Z_OK &&
+                  rawSize == header.rawSize;
+    }
+
+    if (!decoded || checksum(raw) != header.crc)
+    {
+        std::cerr << "Recording block at offset " << pos << " fails its checksum; skipping "
+                  << header.frameCount << " frames.\n";
+        raw.clear();
+        // Whatever the block held, no feed's delta chain can be trusted past it.
+        resetDecoders();
+        return false;
+    }
+    return true;
+}
+
+bool RecordingReader::next(RecordedFrame& frame)
+{
+    if (formatVersion == 1)
+        return nextV1(frame);
+
+    for (;;)
+    {
+        if (rawPos >= raw.size())
+        {
+            if (nextBlock >= index.size())
+            {
+                if (orphanDeltas > 0)
+                    std::cerr << "Skipped " << orphanDeltas << " delta frames whose keyframe was missing.\n";
+                orphanDeltas = 0;
+                return false;
+            }
+            loadBlock(nextBlock++);
+            continue;
+        }
+
+        BinaryIO::Reader reader(std::string_view(raw).substr(rawPos));
+        auto timestamp = reader.get<std::uint64_t>();
+        auto feedId = reader.get<std::uint16_t>();
+        auto kind = formatVersion >= 3 ? reader.get<std::uint8_t>() : std::uint8_t{ Whole };
+        std::string_view data = reader.getBytes(reader.get<std::uint32_t>());
+        if (!reader.ok())
+        {
+            rawPos = raw.size();
+            continue;
+        }
+        rawPos = raw.size() - reader.remaining();
+
+        if (keyframes > 0)
+        {
+            // Frames before the seek target still advance their feed's chain.
+            if (feedId >= decoders.size())
+                decoders.resize(static_cast<std::size_t>(feedId) + 1);
+            FeedDeltaDecoder& decoder = decoders[feedId];
+
+            if (kind == Delta)
+            {
+                if (!decoder.apply(data, frame.data))
+                {
+                    orphanDeltas += timestamp >= skipBefore;
+                    continue;
+                }
+                if (timestamp < skipBefore)
+                    continue;
+
+                frame.timestamp = timestamp;
+                frame.feedId = feedId;
+                return true;
+            }
+            decoder.setBase(data);
+        }
+
+        if (timestamp < skipBefore || kind != Whole)
+            continue;
+
+        frame.timestamp = timestamp;
+        frame.feedId = feedId;
+        frame.data.assign(data);
+        return true;
+    }
+}
+
+bool RecordingReader::nextV1(RecordedFrame& frame)
+{
+    while (nextBlock < index.size())
+    {
+        RecordingBlock const& entry = index[nextBlock++];
+        if (entry.firstTimestamp < skipBefore)
+            continue;
+
+        BinaryIO::Reader reader(bytes.substr(entry.offset));
+        frame.timestamp = reader.get<std::uint64_t>();
+        frame.feedId = RecordedFrame::UNKNOWN_FEED;
+        frame.data.assign(reader.getBytes(reader.get<std::uint32_t>()));
+        return true;
+    }
+    return false;
+}
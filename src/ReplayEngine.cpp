@@ -3,93 +3,199 @@
 #include <thread>
 #include <chrono>
 #include <ctime>
+#include <algorithm>
+#include <vector>
 #include "Parser.hpp"
 #include "SQLiteStore.hpp"
 #include "VirtualClock.hpp"
 #include "StopManager.hpp"
+#include "StaticData.hpp"
+#include "ParseArena.hpp"
+#include "Recording.hpp"
+#include "ReplayPipeline.hpp"
 
-bool ReplayEngine::readChunkHeader(std::ifstream& file, std::uint64_t& timestamp, std::uint32_t& size)
-{
-    file.read(reinterpret_cast<char*>(&timestamp), sizeof(timestamp));
-    file.read(reinterpret_cast<char*>(&size), sizeof(size));
-
-    if (file.eof() || !file.good())
-        return false;
-
-    return true;
-}
-
-void ReplayEngine::syncRealtime(std::uint64_t timestamp, std::uint64_t& replayStart, std::uint64_t realStart)
+void ReplayEngine::syncRealtime(std::uint64_t timestamp, std::uint64_t& replayStart, std::chrono::steady_clock::time_point realStart, double speed)
 {
     if (replayStart == 0)
     {
         replayStart = timestamp;
     }
+    if (speed <= 0 || timestamp <= replayStart)
+        return;
 
-    std::uint64_t recordingDelta = timestamp - replayStart;
-    std::uint64_t realDelta      = static_cast<std::uint64_t>(std::time(nullptr)) - realStart;
+    std::chrono::duration<double> recordingDelta(static_cast<double>(timestamp - replayStart) / speed);
+    auto due  = realStart + std::chrono::duration_cast<std::chrono::steady_clock::duration>(recordingDelta);
+    auto wait = due - std::chrono::steady_clock::now();
 
-    if (recordingDelta > realDelta)
+    if (wait > std::chrono::seconds(1))
     {
-        std::uint64_t waitSeconds = recordingDelta - realDelta;
-        if (waitSeconds > 1)
-        {
-            std::cout << "[REPLAY] Syncing... sleeping for "
-                      << waitSeconds << "s" << std::endl;
-        }
-        std::this_thread::sleep_for(std::chrono::seconds(waitSeconds));
+        std::cout << "[REPLAY] Syncing... sleeping for "
+                  << std::chrono::duration_cast<std::chrono::seconds>(wait).count() << "s" << std::endl;
     }
+    if (wait > std::chrono::steady_clock::duration::zero())
+        std::this_thread::sleep_until(due);
 }
 
-void ReplayEngine::processChunk(std::string& data, std::uint64_t timestamp, SQLiteStore& db, StopManager& stops)
+bool ReplayEngine::run(std::string const& filename, SQLiteStore& db, StaticData& staticData, ReplaySettings const& settings)
 {
-    std::cout << "[REPLAY] Ingesting Snapshot (Recorded T="
-              << timestamp << ")" << std::endl;
+    RecordingReader recording(filename);
+    if (!recording.isOpen())
+    {
+        std::cerr << "Failed to open replay file: " << filename << std::endl;
+        return false;
+    }
 
-    VirtualClock::set(static_cast<std::time_t>(timestamp));
+    if (settings.speed <= 0)
+        std::cout << ">>> STARTING REPLAY MODE (UNTHROTTLED) <<<" << std::endl;
+    else
+        std::cout << ">>> STARTING REPLAY MODE (" << settings.speed << "x SPEED) <<<" << std::endl;
+    std::cout << "[REPLAY] Format v" << recording.version() << ", " << recording.blocks().size()
+              << (recording.version() == 1 ? " frames" : " blocks");
+    if (recording.keyframeInterval() > 0)
+        std::cout << ", delta-coded with a keyframe every " << recording.keyframeInterval() << " frames per feed";
+    std::cout << std::endl;
+
+    if (settings.fromTimestamp > 0)
+    {
+        recording.seek(settings.fromTimestamp);
+        std::cout << "[REPLAY] Starting at T=" << settings.fromTimestamp << std::endl;
+    }
 
-    auto snapshots = Parser::extractSnapshots(data, stops);
-    if (!snapshots.empty())
+    std::uint64_t replayStart = 0;
+    const auto realStart = std::chrono::steady_clock::now();
+    const std::clock_t cpuStart = std::clock();
+    auto lastProgress = realStart;
+    std::size_t frames = 0, snapshots = 0, commits = 0;
+
+    ReplayPipeline pipeline(recording, staticData, settings.parseThreads);
+    std::vector<RecordedBatch> pending;
+    std::size_t pendingSnapshots = 0;
+    auto commit = [&]()
     {
-        std::uint64_t now = static_cast<std::uint64_t>(std::time(nullptr));
-        for (auto& s : snapshots)
+        if (pending.empty())
+            return;
+        db.insertRecorded(pending);
+        pending.clear();
+        pendingSnapshots = 0;
+        ++commits;
+    };
+
+    ServiceDay serviceDay;    // localDate 0 never matches a recording, so the first frame checks it
+    RecordedBatch batch;
+    while (pipeline.next(batch))
+    {
+        syncRealtime(batch.timestamp, replayStart, realStart, settings.speed);
+        VirtualClock::set(static_cast<std::time_t>(batch.timestamp));
+
+        // The first frame of a new service day waits for its schedule. Frames already
+        // pending are committed first, since their stalls are matched against the old one.
+        ServiceDay frameDay = ServiceDay::containing(static_cast<std::time_t>(batch.timestamp));
+        if (!(frameDay == serviceDay))
+        {
+            commit();
+            staticData.rebuildNow(static_cast<std::time_t>(batch.timestamp));
+            serviceDay = frameDay;
+        }
+
+        // Unthrottled, a line per frame would cost more than the frame; report once a second instead.
+        auto now = std::chrono::steady_clock::now();
+        if (settings.speed > 0)
         {
-            s.timestamp = now;
+            std::cout << "[REPLAY] Ingesting Snapshot (Recorded T=" << batch.timestamp << ")" << std::endl;
         }
-        db.insertMany(snapshots);
+        else if (now - lastProgress >= std::chrono::seconds(1))
+        {
+            std::cout << "[REPLAY] Recorded T=" << batch.timestamp << ", " << frames << " frames so far" << std::endl;
+            lastProgress = now;
+        }
+
+        // Snapshots keep the feed's own timestamps, so stored rows match the live run they were recorded from.
+        ++frames;
+        snapshots += batch.snapshots.size();
+        pendingSnapshots += batch.snapshots.size();
+        pending.push_back(std::move(batch));
+
+        // In real time every frame is shown as it lands; flat out, frames share large transactions.
+        if (settings.speed > 0 || pendingSnapshots >= COMMIT_SNAPSHOTS)
+            commit();
     }
+    commit();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - realStart).count();
+    double cpuSeconds = static_cast<double>(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+    std::cout << ">>> REPLAY COMPLETE <<<" << std::endl;
+    std::cout << "[REPLAY] " << frames << " frames, " << snapshots << " snapshots in " << seconds << " s, "
+              << commits << " commits, " << settings.parseThreads << " parse threads";
+    if (seconds > 0)
+    {
+        std::cout << " (" << frames / seconds << " frames/s, " << snapshots / seconds << " snapshots/s, "
+                  << cpuSeconds / seconds << " cores busy on average)";
+    }
+    std::cout << std::endl;
+    return true;
 }
 
-void ReplayEngine::run(std::string const& filename, SQLiteStore& db, StopManager& stops)
+
+bool ReplayEngine::verifyDecoders(std::string const& filename, StopManager const& stops)
 {
-    std::ifstream file(filename, std::ios::binary);
-    if (!file.is_open())
+    RecordingReader recording(filename);
+    if (!recording.isOpen())
     {
         std::cerr << "Failed to open replay file: " << filename << std::endl;
-        return;
+        return false;
     }
 
-    std::cout << ">>> STARTING REPLAY MODE (1:1 SPEED) <<<" << std::endl;
-
-    std::uint64_t replayStart = 0;
-    std::uint64_t realStart   = static_cast<std::uint64_t>(std::time(nullptr));
-
-    while (file.peek() != EOF)
+    auto byTrip = [](TrainSnapshot const& a, TrainSnapshot const& b) { return a.tripId < b.tripId; };
+    auto same = [](TrainSnapshot const& a, TrainSnapshot const& b)
+    {
+        return a.tripId == b.tripId && a.routeId == b.routeId && a.trainId == b.trainId
+            && a.stopId == b.stopId && a.direction == b.direction && a.isAssigned == b.isAssigned
+            && a.currentStatus == b.currentStatus && a.delay == b.delay && a.timestamp == b.timestamp;
+    };
+
+    ParseArena protobufArena;
+    ParseArena wireArena;
+    std::chrono::steady_clock::duration protobufTime{};
+    std::chrono::steady_clock::duration wireTime{};
+    std::size_t frames = 0, mismatches = 0, snapshots = 0;
+
+    RecordedFrame frame;
+    while (recording.next(frame))
     {
-        std::uint64_t timestamp = 0;
-        std::uint32_t size      = 0;
+        std::string_view data = frame.data;
 
-        if (!readChunkHeader(file, timestamp, size))
-            break;
+        auto t0 = std::chrono::steady_clock::now();
+        auto expected = Parser::extractSnapshots(data, stops, protobufArena, Parser::Decoder::Protobuf);
+        auto t1 = std::chrono::steady_clock::now();
+        auto actual = Parser::extractSnapshots(data, stops, wireArena, Parser::Decoder::Wire);
+        auto t2 = std::chrono::steady_clock::now();
 
-        syncRealtime(timestamp, replayStart, realStart);
+        protobufTime += t1 - t0;
+        wireTime     += t2 - t1;
+        protobufArena.reset();
+        wireArena.reset();
 
-        std::string data(size, '\0');
-        file.read(&data[0], size);
+        std::sort(expected.begin(), expected.end(), byTrip);
+        std::sort(actual.begin(), actual.end(), byTrip);
 
-        processChunk(data, timestamp, db, stops);
+        if (!std::equal(expected.begin(), expected.end(), actual.begin(), actual.end(), same))
+        {
+            ++mismatches;
+            std::cerr << "[VERIFY] Frame " << frames << " (T=" << frame.timestamp << ", " << recording.feedName(frame.feedId) << ") differs: "
+                      << expected.size() << " protobuf vs " << actual.size() << " wire snapshots" << std::endl;
+        }
+
+        snapshots += expected.size();
+        ++frames;
     }
 
-    VirtualClock::disable();
-    std::cout << ">>> REPLAY COMPLETE <<<" << std::endl;
+    auto ms = [](std::chrono::steady_clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+    std::cout << "[VERIFY] " << frames << " frames, " << snapshots << " snapshots, "
+              << mismatches << " mismatching frames" << std::endl;
+    std::cout << "[VERIFY] protobuf " << ms(protobufTime) << " ms, wire " << ms(wireTime) << " ms";
+    if (wireTime.count() > 0)
+        std::cout << " (" << ms(protobufTime) / ms(wireTime) << "x)";
+    std::cout << std::endl;
+
+    return mismatches == 0;
 }
@@ -0,0 +1,115 @@
+#include <algorithm>
+#include "ParseArena.hpp"
+#include "Parser.hpp"
+#include "ReplayPipeline.hpp"
+#include "StaticData.hpp"
+
+ReplayPipeline::ReplayPipeline(RecordingReader& source, StaticData const& data, std::size_t workerCount)
+    : recording(source)
+    , staticData(data)
+    , capacity(std::max<std::size_t>(workerCount, 1) * IN_FLIGHT_PER_WORKER)
+{
+    for (std::size_t i = 0; i < std::max<std::size_t>(workerCount, 1); ++i)
+        workers.emplace_back([this]() { decodeFrames(); });
+    reader = std::thread([this]() { readFrames(); });
+}
+
+ReplayPipeline::~ReplayPipeline()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    spaceFree.notify_all();
+    jobReady.notify_all();
+
+    if (reader.joinable())
+        reader.join();
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+void ReplayPipeline::readFrames()
+{
+    for (;;)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            spaceFree.wait(lock, [this]() { return stopping || framesRead - nextSequence < capacity; });
+            if (stopping)
+                break;
+        }
+
+        // The recording is only touched by this thread, so the read itself runs unlocked.
+        if (!recording.next(job.frame))
+            break;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job.sequence = framesRead++;
+            jobs.push_back(std::move(job));
+        }
+        jobReady.notify_one();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        readerDone = true;
+    }
+    jobReady.notify_all();
+    frameReady.notify_all();
+}
+
+void ReplayPipeline::decodeFrames()
+{
+    ParseArena arena;
+    for (;;)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            jobReady.wait(lock, [this]() { return stopping || !jobs.empty() || readerDone; });
+            if (stopping || jobs.empty())
+                return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+
+        RecordedBatch batch;
+        batch.timestamp = job.frame.timestamp;
+        {
+            // A reload mid-replay swaps the pointer, not the stops this decode is using.
+            auto generation = staticData.current();
+            batch.snapshots = Parser::extractSnapshots(job.frame.data, generation->stops, arena);
+        }
+        arena.reset();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            decoded.emplace(job.sequence, std::move(batch));
+        }
+        frameReady.notify_all();
+    }
+}
+
+bool ReplayPipeline::next(RecordedBatch& frame)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    frameReady.wait(lock, [this]()
+    {
+        return decoded.count(nextSequence) > 0 || (readerDone && nextSequence == framesRead);
+    });
+
+    auto it = decoded.find(nextSequence);
+    if (it == decoded.end())
+        return false;
+
+    frame = std::move(it->second);
+    decoded.erase(it);
+    ++nextSequence;
+    lock.unlock();
+
+    spaceFree.notify_one();
+    return true;
+}
@@ -1,20 +1,39 @@
 #include <ctime>
-#include <fstream>
-#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <tuple>
 #include <iostream>
 #include "SQLiteStore.hpp"
+#include "TripKey.hpp"
+#include "VirtualClock.hpp"
+#include "RowBinding.hpp"
+#include "StaticData.hpp"
 
-SQLiteStore::SQLiteStore(std::string const& path)
-    : db(nullptr), insertStmt(nullptr)
+namespace
 {
-    int rc = sqlite3_open(path.c_str(), &db);
-    if (rc != SQLITE_OK)
+    // SQL-callable TripKey::normalize; migration 2 backfills match_key with it.
+    void tripKeyFunction(sqlite3_context* context, int argc, sqlite3_value** argv)
     {
-        std::cerr << "Failed to open SQLite DB: " << sqlite3_errmsg(db) << "\n";
+        if (argc != 1 || sqlite3_value_type(argv[0]) == SQLITE_NULL)
+        {
+            sqlite3_result_null(context);
+            return;
+        }
+
+        const char* text = reinterpret_cast<const char*>(sqlite3_value_text(argv[0]));
+        std::string key = TripKey::normalize(std::string_view(text, static_cast<std::size_t>(sqlite3_value_bytes(argv[0]))));
+        sqlite3_result_text(context, key.data(), static_cast<int>(key.size()), SQLITE_TRANSIENT);
     }
 
-    const char* createSql =
-        "CREATE TABLE IF NOT EXISTS Snapshots ("
+    void registerFunctions(sqlite3* handle)
+    {
+        sqlite3_create_function_v2(handle, "tpa_trip_key", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC,
+                                   nullptr, tripKeyFunction, nullptr, nullptr, nullptr);
+    }
+
+    const char* SNAPSHOT_COLUMNS =
         "  id INTEGER PRIMARY KEY AUTOINCREMENT, "
         "  timestamp INTEGER, "
         "  tripId TEXT, "
@@ -24,70 +43,260 @@ SQLiteStore::SQLiteStore(std::string const& path)
         "  isAssigned INTEGER, "
         "  stopId TEXT, "
         "  currentStatus INTEGER, "
-        "  delay INTEGER"
-        ");"
-        "CREATE TABLE IF NOT EXISTS StationMetrics ("
-        "  stationId TEXT, "
-        "  date TEXT, "
-        "  totalStalls INTEGER, "
-        "  avgDwellTime REAL, "
-        "  maxDwellTime INTEGER, "
-        "  PRIMARY KEY (stationId, date)"
-        ");";
+        "  delay INTEGER";
 
-    char* errMsg = nullptr;
-    rc = sqlite3_exec(db, createSql, nullptr, nullptr, &errMsg);
-    if (rc != SQLITE_OK)
+    const char* INTERVAL_COLUMNS =
+        "  id INTEGER PRIMARY KEY AUTOINCREMENT, "
+        "  tripId TEXT, "
+        "  routeId TEXT, "
+        "  trainId TEXT, "
+        "  direction INTEGER, "
+        "  isAssigned INTEGER, "
+        "  stopId TEXT, "
+        "  currentStatus INTEGER, "
+        "  delay INTEGER, "
+        "  firstSeen INTEGER, "
+        "  lastSeen INTEGER";
+
+    // Covering the recent-stall pattern: WHERE currentStatus = 1 AND timestamp > ? GROUP BY tripId, stopId.
+    const char* SNAPSHOT_RECENT_INDEX =
+        "CREATE INDEX IF NOT EXISTS idx_{table}_recent ON {table}(currentStatus, timestamp, tripId, stopId);";
+
+    const char* INTERVAL_RECENT_INDEX =
+        "CREATE INDEX IF NOT EXISTS idx_{table}_recent ON {table}(currentStatus, lastSeen, tripId, stopId);";
+
+    // Newest interval per trip: WHERE lastSeen > ? GROUP BY tripId (rowid rides along in the index).
+    const char* INTERVAL_OPEN_INDEX =
+        "CREATE INDEX IF NOT EXISTS idx_{table}_open ON {table}(lastSeen, tripId);";
+
+    // Each stop a trip was held at, plus when the trip was last seen moving (NULL if never),
+    // which tells the seed whether that dwell already closed before the restart.
+    const char* SNAPSHOT_SEED_SQL =
+        "SELECT s.tripId, s.routeId, s.trainId, s.direction, s.stopId, s.isAssigned, "
+        "  MIN(s.timestamp), MAX(s.timestamp), MAX(s.delay), moved.lastMoving "
+        "FROM {table} s "
+        "LEFT JOIN (SELECT tripId, MAX(timestamp) AS lastMoving FROM {table} "
+        "           WHERE currentStatus IN (0, 2) AND timestamp > ?1 GROUP BY tripId) moved "
+        "  ON moved.tripId = s.tripId "
+        "WHERE s.currentStatus = 1 AND s.timestamp > ?1 "
+        "GROUP BY s.tripId, s.stopId;";
+
+    const char* INTERVAL_SEED_SQL =
+        "SELECT s.tripId, s.routeId, s.trainId, s.direction, s.stopId, s.isAssigned, "
+        "  MIN(s.firstSeen), MAX(s.lastSeen), MAX(s.delay), moved.lastMoving "
+        "FROM {table} s "
+        "LEFT JOIN (SELECT tripId, MAX(lastSeen) AS lastMoving FROM {table} "
+        "           WHERE currentStatus IN (0, 2) AND lastSeen > ?1 GROUP BY tripId) moved "
+        "  ON moved.tripId = s.tripId "
+        "WHERE s.currentStatus = 1 AND s.lastSeen > ?1 "
+        "GROUP BY s.tripId, s.stopId;";
+
+    const char* OPEN_INTERVAL_SQL =
+        "SELECT id, tripId, trainId, stopId, currentStatus, lastSeen FROM {table} "
+        "WHERE id IN (SELECT MAX(id) FROM {table} WHERE lastSeen > ? GROUP BY tripId);";
+
+    const char* STATION_METRICS_INSERT_SQL =
+        "INSERT OR REPLACE INTO StationMetrics "
+        "(stationId, date, totalStalls, avgDwellTime, maxDwellTime) VALUES (?, ?, ?, ?, ?);";
+
+    const char* DWELL_SKETCH_SELECT_SQL =
+        "SELECT sketch FROM DwellSketches WHERE hourStart = ? AND stationId = ? AND routeId = ?;";
+
+    const char* DWELL_SKETCH_UPSERT_SQL =
+        "INSERT OR REPLACE INTO DwellSketches (hourStart, stationId, routeId, stalls, sketch) VALUES (?, ?, ?, ?, ?);";
+
+    const char* DWELL_SKETCH_RANGE_SQL =
+        "SELECT sketch FROM DwellSketches "
+        "WHERE hourStart >= ?1 AND hourStart < ?2 "
+        "  AND (?3 = '' OR stationId = ?3) AND (?4 = '' OR routeId = ?4);";
+
+    constexpr std::int64_t SKETCH_BUCKET_SECONDS = 3600;
+
+    std::string withTable(const char* sqlTemplate, std::string const& table)
     {
-        std::cerr << "Failed to create tables: "
-                  << (errMsg ? errMsg : "unknown error") << "\n";
-        if (errMsg) sqlite3_free(errMsg);
+        std::string sql = sqlTemplate;
+        for (std::size_t pos; (pos = sql.find("{table}")) != std::string::npos;)
+            sql.replace(pos, 7, table);
+        return sql;
     }
 
-    const char* insertSql =
-        "INSERT INTO Snapshots "
-        "(timestamp, tripId, routeId, trainId, direction, isAssigned, stopId, currentStatus, delay) "
-        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?);";
+    // Statement slots cached per partition.
+    constexpr std::size_t INSERT_SLOT = 0;
+    constexpr std::size_t EXTEND_SLOT = 1;
+
+    const std::string SNAPSHOT_INSERT_SQL = SqlBind::insertSql<TrainSnapshot>("{table}");
+
+    const char* INTERVAL_INSERT_SQL =
+        "INSERT INTO {table} "
+        "(tripId, routeId, trainId, direction, isAssigned, stopId, currentStatus, delay, firstSeen, lastSeen) "
+        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?);";
+
+    const char* INTERVAL_EXTEND_SQL =
+        "UPDATE {table} SET firstSeen = MIN(firstSeen, ?1), lastSeen = MAX(lastSeen, ?1), delay = MAX(delay, ?2) WHERE id = ?3;";
+
+    // Stalls of one sealed partition, per station.
+    const char* SNAPSHOT_ROLLUP_SQL =
+        "SELECT stopId, COUNT(*), AVG(dwell), MAX(dwell) FROM ("
+        "  SELECT stopId, MAX(timestamp) - MIN(timestamp) AS dwell FROM {table} "
+        "  WHERE currentStatus = 1 GROUP BY tripId, stopId "
+        "  HAVING dwell > 60"
+        ") GROUP BY stopId;";
+
+    const char* INTERVAL_ROLLUP_SQL =
+        "SELECT stopId, COUNT(*), AVG(dwell), MAX(dwell) FROM ("
+        "  SELECT stopId, MAX(lastSeen) - MIN(firstSeen) AS dwell FROM {table} "
+        "  WHERE currentStatus = 1 GROUP BY tripId, stopId "
+        "  HAVING dwell > 60"
+        ") GROUP BY stopId;";
+}
+
+SQLiteStore::SQLiteStore(std::string const& path, std::size_t readerCount, StorageMode mode, std::string_view warmDwellState)
+    : db(nullptr)
+    , storageMode(mode)
+    , snapshotPartitions("Snapshots", SNAPSHOT_COLUMNS, { SNAPSHOT_RECENT_INDEX })
+    , intervalPartitions("Intervals", INTERVAL_COLUMNS, { INTERVAL_RECENT_INDEX, INTERVAL_OPEN_INDEX })
+{
+    int rc = sqlite3_open(path.c_str(), &db);
+    if (rc != SQLITE_OK)
+    {
+        std::cerr << "Failed to open SQLite DB: " << sqlite3_errmsg(db) << "\n";
+    }
 
-    rc = sqlite3_prepare_v2(db, insertSql, -1, &insertStmt, nullptr);
+    // WAL lets readers keep their snapshot while the writer appends; NORMAL only syncs at checkpoints.
+    char* walErr = nullptr;
+    rc = sqlite3_exec(db, "PRAGMA journal_mode=WAL; PRAGMA synchronous=NORMAL;", nullptr, nullptr, &walErr);
     if (rc != SQLITE_OK)
     {
-        std::cerr << "Failed to prepare insert statement: "
-                  << sqlite3_errmsg(db) << "\n";
-        insertStmt = nullptr;
+        std::cerr << "Failed to enable WAL: " << (walErr ? walErr : "unknown error") << "\n";
+        if (walErr) sqlite3_free(walErr);
+    }
+    sqlite3_busy_timeout(db, 5000);
+    registerFunctions(db);
+    writerStatements.setConnection(db);
+
+    const std::int64_t today = PartitionSet::dayOf(VirtualClock::now());
+    snapshotPartitions.attach(db, today);
+    intervalPartitions.attach(db, today);
+
+    runMigrations();
+    checkQueryPlans();
+
+    if (storageMode == StorageMode::Intervals)
+        loadOpenIntervals();
+
+    // A warm-start state only needs the rows written after it was saved.
+    std::uint64_t restoredUpTo = 0;
+    if (!warmDwellState.empty() && !tracker.restore(warmDwellState, restoredUpTo))
+    {
+        std::cerr << "Warm-start dwell state is unreadable; reseeding from the database.\n";
+        restoredUpTo = 0;
     }
+
+    seedDwellTracker(restoredUpTo);
+    openReaders(path, readerCount);
 }
 
 SQLiteStore::~SQLiteStore()
 {
-    if (insertStmt) sqlite3_finalize(insertStmt);
+    readerStatements.clear();
+    writerStatements.clear();
+    for (sqlite3* reader : readers)
+        sqlite3_close(reader);
+    snapshotPartitions.finalizeStatements();
+    intervalPartitions.finalizeStatements();
     if (db) sqlite3_close(db);
 }
 
+void SQLiteStore::openReaders(std::string const& path, std::size_t count)
+{
+    for (std::size_t i = 0; i < std::max<std::size_t>(count, 1); ++i)
+    {
+        sqlite3* reader = nullptr;
+        int rc = sqlite3_open_v2(path.c_str(), &reader, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, nullptr);
+        if (rc != SQLITE_OK)
+        {
+            std::cerr << "Failed to open read connection: " << sqlite3_errmsg(reader) << "\n";
+            sqlite3_close(reader);
+            continue;
+        }
+
+        sqlite3_busy_timeout(reader, 5000);
+        registerFunctions(reader);
+        readers.push_back(reader);
+        readerStatements.emplace(reader, StatementCache(reader));
+    }
+
+    idleReaders = readers;
+    std::cout << "[System] Opened " << readers.size() << " read-only database connections." << std::endl;
+}
+
+SQLiteStore::ReadLease::ReadLease(SQLiteStore& owner)
+    : store(owner), handle(nullptr)
+{
+    std::unique_lock<std::mutex> lock(store.readerMutex);
+
+    // No read connection could be opened: fall back to the writer under its lock.
+    if (store.readers.empty())
+    {
+        lock.unlock();
+        store.writeMutex.lock();
+        handle = store.db;
+        return;
+    }
+
+    store.readerAvailable.wait(lock, [this]() { return !store.idleReaders.empty(); });
+    handle = store.idleReaders.back();
+    store.idleReaders.pop_back();
+}
+
+SQLiteStore::ReadLease::~ReadLease()
+{
+    if (handle == store.db)
+    {
+        store.writeMutex.unlock();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(store.readerMutex);
+        store.idleReaders.push_back(handle);
+    }
+    store.readerAvailable.notify_one();
+}
+
+StatementCache& SQLiteStore::statementsFor(sqlite3* handle)
+{
+    // readerStatements is filled once in openReaders and never changes, so lookups need no lock.
+    auto it = readerStatements.find(handle);
+    return it != readerStatements.end() ? it->second : writerStatements;
+}
+
 void SQLiteStore::insert(const TrainSnapshot& s)
 {
-    std::lock_guard<std::mutex> lock(mutex);
+    std::lock_guard<std::mutex> lock(writeMutex);
     insertInternal(s);
+    recordClosedDwells();
+    publishStalls();
 }
 
 void SQLiteStore::insertInternal(TrainSnapshot const& s)
 {
+    tracker.observe(s);
+
+    if (storageMode == StorageMode::Intervals)
+    {
+        appendInterval(s, openIntervals);
+        return;
+    }
+
+    CachedStatement insertStmt(snapshotPartitions.statement(PartitionSet::dayOf(static_cast<std::int64_t>(s.timestamp)),
+                                                            INSERT_SLOT, SNAPSHOT_INSERT_SQL.c_str()));
     if (!insertStmt)
         return; 
 
-    sqlite3_reset(insertStmt);
-
-    sqlite3_bind_int64(insertStmt, 1, static_cast<sqlite3_int64>(s.timestamp));
-    sqlite3_bind_text(insertStmt, 2, s.tripId.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(insertStmt, 3, s.routeId.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(insertStmt, 4, s.trainId.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_int(insertStmt, 5, s.direction);
-    sqlite3_bind_int(insertStmt, 6, s.isAssigned ? 1 : 0);
-    sqlite3_bind_text(insertStmt, 7, s.stopId.c_str(), -1, SQLITE_TRANSIENT);
-    sqlite3_bind_int(insertStmt, 8, s.currentStatus);
-    sqlite3_bind_int(insertStmt, 9, s.delay);
+    SqlBind::bindRow(insertStmt.get(), s);
 
-    int rc = sqlite3_step(insertStmt);
+    int rc = sqlite3_step(insertStmt.get());
     if (rc != SQLITE_DONE)
     {
         std::cerr << "SQLite insert failed: " << sqlite3_errmsg(db) << "\n";
@@ -96,99 +305,569 @@ void SQLiteStore::insertInternal(TrainSnapshot const& s)
 
 void SQLiteStore::insertMany(const std::vector<TrainSnapshot>& snapshots)
 {
-    std::lock_guard<std::mutex> lock(mutex);
+    std::lock_guard<std::mutex> lock(writeMutex);
 
     sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
 
     for (const TrainSnapshot& s : snapshots)
         insertInternal(s);
+    recordClosedDwells();
 
     sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+    publishStalls();
 }
 
-std::vector<TrainSnapshot> SQLiteStore::getRecentStalls()
+void SQLiteStore::insertBatches(std::vector<std::vector<TrainSnapshot>> const& batches)
 {
-    std::lock_guard<std::mutex> lock(mutex);
+    std::lock_guard<std::mutex> lock(writeMutex);
 
-    std::vector<TrainSnapshot> results;
-    const char* sql =
-        "SELECT "
-        "  S.tripId, S.routeId, S.trainId, S.direction, S.stopId, "
-        "  MAX(S.timestamp) - MIN(S.timestamp) as dwellTimeSeconds, "
-        "  MAX(S.delay) as reportedDelay, "
-        "  SCH.arrival_sec "
-        "FROM Snapshots S "
-        "LEFT JOIN StaticSchedule SCH ON SCH.trip_id LIKE '%' || S.tripId || '%' " 
-        "  AND S.stopId = SCH.stop_id " 
-        "WHERE S.currentStatus = 1 "
-        "AND S.stopId NOT LIKE '701%' "
-        "AND S.stopId NOT LIKE 'D43%' "
-        "AND S.stopId NOT LIKE 'G05%' "
-        "AND S.stopId NOT LIKE '207%' "
-        "AND S.stopId NOT LIKE 'A65%' "
-        "AND S.timestamp > (strftime('%s','now') - 1800) " 
-        "GROUP BY S.tripId, S.stopId "
-        "HAVING dwellTimeSeconds > 60 " 
-        "AND MAX(S.timestamp) > (strftime('%s','now') - 60) " 
-        "ORDER BY dwellTimeSeconds DESC;";
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
 
-    sqlite3_stmt* stmt = nullptr;
+    for (auto const& batch : batches)
+        for (const TrainSnapshot& s : batch)
+            insertInternal(s);
+    recordClosedDwells();
 
-    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK)
+    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+    publishStalls();
+}
+
+void SQLiteStore::insertRecorded(std::vector<RecordedBatch> const& frames)
+{
+    std::lock_guard<std::mutex> lock(writeMutex);
+
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+
+    for (RecordedBatch const& frame : frames)
+    {
+        if (frame.snapshots.empty())
+            continue;
+
+        for (const TrainSnapshot& s : frame.snapshots)
+            insertInternal(s);
+        recordClosedDwells();
+        publishStalls(static_cast<std::int64_t>(frame.timestamp));
+    }
+
+    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+}
+
+void SQLiteStore::appendInterval(TrainSnapshot const& s, OpenIntervalMap& open)
+{
+    auto it = open.find(s.tripId);
+    if (it != open.end())
+    {
+        OpenInterval& current = it->second;
+        if (current.stopId == s.stopId && current.currentStatus == s.currentStatus && current.trainId == s.trainId)
+        {
+            // The interval stays in the partition of the day it opened, even past midnight.
+            CachedStatement extendStmt(intervalPartitions.statement(current.day, EXTEND_SLOT, INTERVAL_EXTEND_SQL));
+            if (!extendStmt)
+                return;
+
+            SqlBind::bindAll(extendStmt.get(), s.timestamp, s.delay, current.rowId);
+
+            if (sqlite3_step(extendStmt.get()) != SQLITE_DONE)
+                std::cerr << "SQLite interval update failed: " << sqlite3_errmsg(db) << "\n";
+
+            current.lastSeen = std::max(current.lastSeen, s.timestamp);
+            return;
+        }
+    }
+
+    const std::int64_t day = PartitionSet::dayOf(static_cast<std::int64_t>(s.timestamp));
+    CachedStatement insertStmt(intervalPartitions.statement(day, INSERT_SLOT, INTERVAL_INSERT_SQL));
+    if (!insertStmt)
+        return;
+
+    SqlBind::bindAll(insertStmt.get(), s.tripId, s.routeId, s.trainId, s.direction, s.isAssigned,
+                     s.stopId, s.currentStatus, s.delay, s.timestamp, s.timestamp);
+
+    if (sqlite3_step(insertStmt.get()) != SQLITE_DONE)
+    {
+        std::cerr << "SQLite interval insert failed: " << sqlite3_errmsg(db) << "\n";
+        return;
+    }
+
+    OpenInterval& opened = open[s.tripId];
+    opened.rowId = sqlite3_last_insert_rowid(db);
+    opened.day = day;
+    opened.trainId = s.trainId;
+    opened.stopId = s.stopId;
+    opened.currentStatus = s.currentStatus;
+    opened.lastSeen = s.timestamp;
+}
+
+void SQLiteStore::loadOpenIntervals()
+{
+    // The newest interval of every trip seen recently is still open and keeps being extended.
+    // Intervals left in the pre-partitioning table are not reopened; those trips start a new one.
+    const std::int64_t windowStart = static_cast<std::int64_t>(VirtualClock::now()) - DwellTracker::WINDOW_SECONDS;
+
+    openIntervals.clear();
+    for (auto const& partition : intervalPartitions.partitionsSince(PartitionSet::dayOf(windowStart)))
+    {
+        std::string sql = withTable(OPEN_INTERVAL_SQL, partition.name);
+
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+        {
+            std::cerr << "Failed to prepare open interval query: " << sqlite3_errmsg(db) << "\n";
+            continue;
+        }
+
+        sqlite3_bind_int64(stmt, 1, windowStart);
+
+        // Partitions are visited oldest first, so a later day's interval replaces an earlier one.
+        while (sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            const unsigned char* tripId  = sqlite3_column_text(stmt, 1);
+            const unsigned char* trainId = sqlite3_column_text(stmt, 2);
+            const unsigned char* stopId  = sqlite3_column_text(stmt, 3);
+            if (!tripId)
+                continue;
+
+            OpenInterval& open = openIntervals[reinterpret_cast<const char*>(tripId)];
+            open.rowId = sqlite3_column_int64(stmt, 0);
+            open.day = partition.day;
+            open.trainId = trainId ? reinterpret_cast<const char*>(trainId) : "";
+            open.stopId = stopId ? reinterpret_cast<const char*>(stopId) : "";
+            open.currentStatus = sqlite3_column_int(stmt, 4);
+            open.lastSeen = static_cast<std::uint64_t>(sqlite3_column_int64(stmt, 5));
+        }
+        sqlite3_finalize(stmt);
+    }
+}
+
+IntervalMigrationReport SQLiteStore::migrateToIntervals()
+{
+    std::lock_guard<std::mutex> lock(writeMutex);
+    IntervalMigrationReport report;
+
+    // Only rows older than anything already stored as intervals, so a re-run never duplicates.
+    const char* selectSql =
+        "SELECT timestamp, tripId, routeId, trainId, direction, isAssigned, stopId, currentStatus, delay "
+        "FROM AllSnapshots "
+        "WHERE timestamp < COALESCE((SELECT MIN(firstSeen) FROM AllIntervals), 9223372036854775807) "
+        "ORDER BY tripId, timestamp;";
+
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, selectSql, -1, &stmt, nullptr) != SQLITE_OK)
     {
-        std::cerr << "Failed to prepare getRecentStalls: "
-                  << sqlite3_errmsg(db) << "\n";
-        return results;
+        std::cerr << "Failed to prepare interval migration: " << sqlite3_errmsg(db) << "\n";
+        return report;
     }
 
-    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+    auto text = [&stmt](int column)
+    {
+        const unsigned char* value = sqlite3_column_text(stmt, column);
+        return value ? std::string(reinterpret_cast<const char*>(value)) : std::string();
+    };
+
+    OpenIntervalMap open;
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+    while (sqlite3_step(stmt) == SQLITE_ROW)
     {
         TrainSnapshot s;
+        s.timestamp     = static_cast<std::uint64_t>(sqlite3_column_int64(stmt, 0));
+        s.tripId        = text(1);
+        s.routeId       = text(2);
+        s.trainId       = text(3);
+        s.direction     = sqlite3_column_int(stmt, 4);
+        s.isAssigned    = sqlite3_column_int(stmt, 5) != 0;
+        s.stopId        = text(6);
+        s.currentStatus = sqlite3_column_int(stmt, 7);
+        s.delay         = sqlite3_column_int(stmt, 8);
+
+        appendInterval(s, open);
+        ++report.migratedRows;
+
+        // Rows come grouped by trip, so earlier trips can be closed as soon as the next one starts.
+        if (open.size() > 1)
+            open.erase(std::find_if(open.begin(), open.end(), [&s](auto const& entry) { return entry.first != s.tripId; }));
+    }
+    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+    sqlite3_finalize(stmt);
+
+    if (storageMode == StorageMode::Intervals)
+        loadOpenIntervals();
+
+    auto countRows = [this](const char* sql)
+    {
+        sqlite3_stmt* countStmt = nullptr;
+        std::int64_t count = 0;
+        if (sqlite3_prepare_v2(db, sql, -1, &countStmt, nullptr) == SQLITE_OK && sqlite3_step(countStmt) == SQLITE_ROW)
+            count = sqlite3_column_int64(countStmt, 0);
+        sqlite3_finalize(countStmt);
+        return count;
+    };
+
+    // dbstat is optional in SQLite builds; sizes stay -1 without it. Covers every partition of the family.
+    auto tableBytes = [this](const char* table)
+    {
+        sqlite3_stmt* sizeStmt = nullptr;
+        std::int64_t bytes = -1;
+        if (sqlite3_prepare_v2(db, "SELECT SUM(pgsize) FROM dbstat WHERE name = ?1 OR name GLOB ?1 || '_[0-9]*';", -1, &sizeStmt, nullptr) == SQLITE_OK)
+        {
+            sqlite3_bind_text(sizeStmt, 1, table, -1, SQLITE_STATIC);
+            if (sqlite3_step(sizeStmt) == SQLITE_ROW)
+                bytes = sqlite3_column_int64(sizeStmt, 0);
+        }
+        sqlite3_finalize(sizeStmt);
+        return bytes;
+    };
+
+    // Best of three runs of the same "every dwell over 60 s" question against each layout.
+    auto timeQuery = [this](const char* sql, std::int64_t& rows)
+    {
+        std::int64_t best = -1;
+        for (int run = 0; run < 3; ++run)
+        {
+            sqlite3_stmt* queryStmt = nullptr;
+            auto started = std::chrono::steady_clock::now();
+            rows = 0;
+            if (sqlite3_prepare_v2(db, sql, -1, &queryStmt, nullptr) == SQLITE_OK)
+            {
+                while (sqlite3_step(queryStmt) == SQLITE_ROW)
+                    ++rows;
+            }
+            sqlite3_finalize(queryStmt);
+            auto micros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started).count();
+            if (best < 0 || micros < best)
+                best = micros;
+        }
+        return best;
+    };
+
+    report.snapshotRows  = countRows("SELECT COUNT(*) FROM AllSnapshots;");
+    report.intervalRows  = countRows("SELECT COUNT(*) FROM AllIntervals;");
+    report.snapshotBytes = tableBytes("Snapshots");
+    report.intervalBytes = tableBytes("Intervals");
+
+    report.snapshotQueryMicros = timeQuery(
+        "SELECT tripId, stopId, MAX(timestamp) - MIN(timestamp) AS dwell FROM AllSnapshots "
+        "WHERE currentStatus = 1 GROUP BY tripId, stopId HAVING dwell > 60;",
+        report.snapshotStalls);
+    report.intervalQueryMicros = timeQuery(
+        "SELECT tripId, stopId, lastSeen - firstSeen AS dwell FROM AllIntervals "
+        "WHERE currentStatus = 1 AND lastSeen - firstSeen > 60;",
+        report.intervalStalls);
+
+    return report;
+}
+
+std::shared_ptr<const DwellTracker::StallList> SQLiteStore::getRecentStalls() const
+{
+    return tracker.current();
+}
+
+void SQLiteStore::setStaticData(StaticData const* data)
+{
+    std::lock_guard<std::mutex> lock(writeMutex);
+    staticData = data;
+    publishStalls();
+}
+
+void SQLiteStore::refreshStalls()
+{
+    std::lock_guard<std::mutex> lock(writeMutex);
+    publishStalls();
+
+    // Dwells the publish just evicted would otherwise wait for the feeds to come back.
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+    recordClosedDwells();
+    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+}
 
-        const unsigned char* tripId  = sqlite3_column_text(stmt, 0);
-        const unsigned char* routeId = sqlite3_column_text(stmt, 1);
-        const unsigned char* trainId = sqlite3_column_text(stmt, 2);
-        const unsigned char* stopId  = sqlite3_column_text(stmt, 4);
+void SQLiteStore::publishStalls()
+{
+    publishStalls(static_cast<std::int64_t>(VirtualClock::now()));
+}
 
-        s.tripId  = tripId  ? reinterpret_cast<const char*>(tripId)  : "";
-        s.routeId = routeId ? reinterpret_cast<const char*>(routeId) : "";
-        s.trainId = trainId ? reinterpret_cast<const char*>(trainId) : "";
-        s.direction = sqlite3_column_int(stmt, 3);
-        s.stopId    = stopId ? reinterpret_cast<const char*>(stopId) : "";
+void SQLiteStore::publishStalls(std::int64_t now)
+{
+    // Held for the whole publish, so a reload landing mid-way can't free it.
+    auto generation = staticData ? staticData->current() : nullptr;
+    if (!generation)
+    {
+        tracker.publish(now, nullptr);
+        return;
+    }
 
-        s.dwellTimeSeconds = sqlite3_column_int(stmt, 5);
-        s.delay            = sqlite3_column_int(stmt, 6);
+    // Also covers entries published before any generation existed, cached as "no match".
+    if (generation->number != scheduleGeneration)
+    {
+        tracker.forgetSchedules();
+        scheduleGeneration = generation->number;
+    }
 
-        if (sqlite3_column_type(stmt, 7) != SQLITE_NULL)
-            s.scheduledArrivalSec = sqlite3_column_int(stmt, 7);
-        else
-            s.scheduledArrivalSec = 0;  
+    tracker.publish(now,
+                    [&generation](std::string const& tripId, std::string const& stopId, std::uint64_t seenAt)
+                    {
+                        return generation->schedule.lookup(tripId, stopId, static_cast<std::int64_t>(seenAt));
+                    });
+}
 
-        s.currentStatus = 1;
+void SQLiteStore::recordClosedDwells()
+{
+    // Dwells evicted by the previous publish are picked up here too, one write later.
+    auto closed = tracker.takeClosed();
+    if (closed.empty())
+        return;
 
-        results.push_back(std::move(s));
+    using SketchKey = std::tuple<std::int64_t, std::string, std::string>;    // hourStart, stationId, routeId
+    std::map<SketchKey, DwellSketch> added;
+    for (auto const& dwell : closed)
+    {
+        auto firstSeen = static_cast<std::int64_t>(dwell.firstSeen);
+        added[{ firstSeen - firstSeen % SKETCH_BUCKET_SECONDS, dwell.stopId, dwell.routeId }].add(dwell.dwellSeconds);
     }
 
-    if (rc != SQLITE_DONE)
+    for (auto& [key, sketch] : added)
+    {
+        auto const& [hourStart, stationId, routeId] = key;
+
+        {
+            CachedStatement select(writerStatements.get(DWELL_SKETCH_SELECT_SQL));
+            if (!select)
+                return;
+
+            SqlBind::bindAll(select.get(), hourStart, stationId, routeId);
+            if (sqlite3_step(select.get()) == SQLITE_ROW)
+            {
+                SqlBind::Blob stored;
+                SqlBind::readAll(select.get(), stored);
+
+                DwellSketch existing;
+                if (DwellSketch::deserialize(stored.bytes, existing))
+                    sketch.merge(existing);
+                else
+                    std::cerr << "Discarding unreadable dwell sketch for " << stationId << " at " << hourStart << "\n";
+            }
+        }
+
+        CachedStatement upsert(writerStatements.get(DWELL_SKETCH_UPSERT_SQL));
+        if (!upsert)
+            return;
+
+        SqlBind::Blob blob{ sketch.serialize() };
+        SqlBind::bindAll(upsert.get(), hourStart, stationId, routeId, sketch.count(), blob);
+        if (sqlite3_step(upsert.get()) != SQLITE_DONE)
+            std::cerr << "SQLite dwell sketch write failed: " << sqlite3_errmsg(db) << "\n";
+    }
+}
+
+DwellPercentiles SQLiteStore::getDwellPercentiles(std::int64_t fromTs, std::int64_t toTs,
+                                                  std::string const& stationId, std::string const& routeId)
+{
+    DwellSketch merged;
+    {
+        ReadLease reader(*this);
+        CachedStatement stmt(statementsFor(reader.get()).get(DWELL_SKETCH_RANGE_SQL));
+        if (!stmt)
+            return {};
+
+        SqlBind::bindAll(stmt.get(), fromTs - fromTs % SKETCH_BUCKET_SECONDS, toTs, stationId, routeId);
+
+        SqlBind::Blob stored;
+        DwellSketch sketch;
+        while (sqlite3_step(stmt.get()) == SQLITE_ROW)
+        {
+            SqlBind::readAll(stmt.get(), stored);
+            if (DwellSketch::deserialize(stored.bytes, sketch))
+                merged.merge(sketch);
+        }
+    }
+
+    DwellPercentiles result;
+    result.stalls = merged.count();
+    result.p50 = merged.quantile(0.50);
+    result.p95 = merged.quantile(0.95);
+    result.p99 = merged.quantile(0.99);
+    return result;
+}
+
+std::string SQLiteStore::exportDwellState()
+{
+    std::lock_guard<std::mutex> lock(writeMutex);
+    std::string state;
+    tracker.serialize(state);
+    return state;
+}
+
+void SQLiteStore::seedDwellTracker(std::uint64_t restoredUpTo)
+{
+    // Rebuild the tracker from the last window so a restart doesn't forget trains already held;
+    // on top of restored state only rows from its newest second onwards are replayed.
+    auto windowStart = static_cast<sqlite3_int64>(VirtualClock::now()) - DwellTracker::WINDOW_SECONDS;
+    if (restoredUpTo > 0)
+        windowStart = std::max(windowStart, static_cast<sqlite3_int64>(restoredUpTo) - 1);
+    auto windowDay = PartitionSet::dayOf(windowStart);
+
+    std::string sql = storageMode == StorageMode::Intervals
+        ? withTable(INTERVAL_SEED_SQL, intervalPartitions.since(windowDay))
+        : withTable(SNAPSHOT_SEED_SQL, snapshotPartitions.since(windowDay));
+
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
     {
-        std::cerr << "Error stepping getRecentStalls: "
-                  << sqlite3_errmsg(db) << "\n";
+        std::cerr << "Failed to prepare dwell seed query: " << sqlite3_errmsg(db) << "\n";
+        return;
     }
 
+    sqlite3_bind_int64(stmt, 1, windowStart);
+
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+    {
+        auto text = [stmt](int column)
+        {
+            const unsigned char* value = sqlite3_column_text(stmt, column);
+            return value ? std::string(reinterpret_cast<const char*>(value)) : std::string();
+        };
+
+        TrainSnapshot s;
+        s.tripId     = text(0);
+        s.routeId    = text(1);
+        s.trainId    = text(2);
+        s.direction  = sqlite3_column_int(stmt, 3);
+        s.stopId     = text(4);
+        s.isAssigned = sqlite3_column_int(stmt, 5) != 0;
+        s.delay      = sqlite3_column_int(stmt, 8);
+
+        tracker.seed(s,
+                     static_cast<std::uint64_t>(sqlite3_column_int64(stmt, 6)),
+                     static_cast<std::uint64_t>(sqlite3_column_int64(stmt, 7)),
+                     static_cast<std::uint64_t>(sqlite3_column_int64(stmt, 9)));
+    }
     sqlite3_finalize(stmt);
-    return results;
+
+    publishStalls();
+    std::cout << "[System] Dwell tracker " << (restoredUpTo > 0 ? "restored" : "seeded") << " with "
+              << tracker.size() << " stops." << std::endl;
 }
 
 
 void SQLiteStore::pruneOldData(int daysToKeep)
 {
-    std::lock_guard<std::mutex> lock(mutex);
-
     const long long cutoffSeconds   = static_cast<long long>(daysToKeep) * 86400LL;
-    const long long cutoffTimestamp = std::time(nullptr) - cutoffSeconds;
+    const long long now             = VirtualClock::now();
+    const long long cutoffTimestamp = now - cutoffSeconds;
+    const std::int64_t cutoffDay    = PartitionSet::dayOf(cutoffTimestamp);
+
+    // Late rows and intervals that opened before midnight keep landing in the previous day's
+    // partition for up to a dwell window, so a day is only sealed once that has passed.
+    rollupSealedPartitions(PartitionSet::dayOf(now - DwellTracker::WINDOW_SECONDS));
+
+    std::lock_guard<std::mutex> lock(writeMutex);
+    auto started = std::chrono::steady_clock::now();
+
+    pruneLegacyTables(cutoffTimestamp);
+
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+    std::size_t dropped = snapshotPartitions.dropBefore(cutoffDay) + intervalPartitions.dropBefore(cutoffDay);
+    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+
+    const auto openCutoff = static_cast<std::uint64_t>(VirtualClock::now() - DwellTracker::WINDOW_SECONDS);
+    std::erase_if(openIntervals, [openCutoff, cutoffDay](auto const& entry)
+    {
+        return entry.second.lastSeen < openCutoff || entry.second.day < cutoffDay;
+    });
+
+    if (dropped > 0)
+    {
+        auto micros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started).count();
+        std::cout << "[System] Dropped " << dropped << " expired partitions in " << micros / 1000.0 << " ms." << std::endl;
+    }
+}
+
+void SQLiteStore::rollupSealedPartitions(std::int64_t sealedBefore)
+{
+    struct StationMetric
+    {
+        std::string stationId;
+        int totalStalls = 0;
+        double avgDwellTime = 0;
+        int maxDwellTime = 0;
+    };
+
+    for (auto [partitions, rollupSql] : { std::pair{ &snapshotPartitions, SNAPSHOT_ROLLUP_SQL },
+                                          std::pair{ &intervalPartitions, INTERVAL_ROLLUP_SQL } })
+    {
+        std::vector<PartitionSet::Partition> pending;
+        {
+            std::lock_guard<std::mutex> lock(writeMutex);
+            pending = partitions->pendingRollups(sealedBefore);
+
+            // An interval still open can be extended in place, so its day isn't sealed yet.
+            if (partitions == &intervalPartitions)
+            {
+                std::erase_if(pending, [this](PartitionSet::Partition const& partition)
+                {
+                    return std::any_of(openIntervals.begin(), openIntervals.end(), [&partition](auto const& entry)
+                    {
+                        return entry.second.day == partition.day;
+                    });
+                });
+            }
+        }
+
+        for (auto const& partition : pending)
+        {
+            // A sealed day never changes again, so it is aggregated on a read connection
+            // and only the few result rows are written under the write lock.
+            std::vector<StationMetric> metrics;
+            {
+                ReadLease reader(*this);
+
+                std::string sql = rollupSql;
+                sql.replace(sql.find("{table}"), 7, partition.name);
+
+                sqlite3_stmt* stmt = nullptr;
+                if (sqlite3_prepare_v2(reader.get(), sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+                {
+                    std::cerr << "Failed to prepare rollup for " << partition.name << ": "
+                              << sqlite3_errmsg(reader.get()) << "\n";
+                    continue;
+                }
+
+                while (sqlite3_step(stmt) == SQLITE_ROW)
+                {
+                    StationMetric metric;
+                    SqlBind::readAll(stmt, metric.stationId, metric.totalStalls, metric.avgDwellTime, metric.maxDwellTime);
+                    metrics.push_back(std::move(metric));
+                }
+                sqlite3_finalize(stmt);
+            }
+
+            std::lock_guard<std::mutex> lock(writeMutex);
+            std::string date = PartitionSet::isoDate(partition.day);
+
+            sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+
+            for (auto const& metric : metrics)
+            {
+                CachedStatement stmt(writerStatements.get(STATION_METRICS_INSERT_SQL));
+                if (!stmt)
+                    break;
+
+                SqlBind::bindAll(stmt.get(), metric.stationId, date, metric.totalStalls,
+                                 metric.avgDwellTime, metric.maxDwellTime);
+                sqlite3_step(stmt.get());
+            }
 
-    const char* compressSql =
+            partitions->markRolledUp(partition.day);
+            sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+
+            std::cout << "[System] Rolled up " << partition.name << " into StationMetrics ("
+                      << metrics.size() << " stations)." << std::endl;
+        }
+    }
+}
+
+void SQLiteStore::pruneLegacyTables(long long cutoffTimestamp)
+{
+    // Tables from before partitioning are still trimmed row by row, and dropped once they're empty.
+    const char* snapshotCompressSql =
         "WITH per_stall AS ("
         "  SELECT "
         "    stopId AS stationId, "
@@ -210,143 +889,289 @@ void SQLiteStore::pruneOldData(int daysToKeep)
         "FROM per_stall "
         "GROUP BY stationId, d;";
 
-    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+    const char* intervalCompressSql =
+        "WITH per_stall AS ("
+        "  SELECT "
+        "    stopId AS stationId, "
+        "    date(firstSeen, 'unixepoch') AS d, "
+        "    (MAX(lastSeen) - MIN(firstSeen)) AS dwell "
+        "  FROM Intervals "
+        "  WHERE lastSeen < ? AND currentStatus = 1 "
+        "  GROUP BY tripId, stopId, date(firstSeen, 'unixepoch') "
+        "  HAVING (MAX(lastSeen) - MIN(firstSeen)) > 60"
+        ") "
+        "INSERT OR REPLACE INTO StationMetrics "
+        "  (stationId, date, totalStalls, avgDwellTime, maxDwellTime) "
+        "SELECT "
+        "  stationId, "
+        "  d AS date, "
+        "  COUNT(*) AS totalStalls, "
+        "  AVG(dwell) AS avgDwellTime, "
+        "  MAX(dwell) AS maxDwellTime "
+        "FROM per_stall "
+        "GROUP BY stationId, d;";
 
+    struct LegacyTable
     {
-        sqlite3_stmt* stmt = nullptr;
-        if (sqlite3_prepare_v2(db, compressSql, -1, &stmt, nullptr) == SQLITE_OK)
+        PartitionSet& partitions;
+        const char* compressSql;
+        const char* deleteSql;
+        const char* countSql;
+    };
+
+    for (LegacyTable table : { LegacyTable{ snapshotPartitions, snapshotCompressSql,
+                                            "DELETE FROM Snapshots WHERE timestamp < ?;",
+                                            "SELECT EXISTS (SELECT 1 FROM Snapshots);" },
+                               LegacyTable{ intervalPartitions, intervalCompressSql,
+                                            "DELETE FROM Intervals WHERE lastSeen < ?;",
+                                            "SELECT EXISTS (SELECT 1 FROM Intervals);" } })
+    {
+        if (!table.partitions.hasLegacy())
+            continue;
+
+        sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+
+        for (const char* sql : { table.compressSql, table.deleteSql })
         {
-            sqlite3_bind_int64(stmt, 1, static_cast<sqlite3_int64>(cutoffTimestamp));
-            int rc = sqlite3_step(stmt);
+            CachedStatement stmt(writerStatements.get(sql));
+            if (!stmt)
+                continue;
+
+            SqlBind::bindAll(stmt.get(), cutoffTimestamp);
+            int rc = sqlite3_step(stmt.get());
             if (rc != SQLITE_DONE)
             {
-                std::cerr << "StationMetrics compression failed: "
+                std::cerr << "Legacy prune failed: "
                           << sqlite3_errmsg(db) << "\n";
             }
-            sqlite3_finalize(stmt);
-        }
-        else
-        {
-            std::cerr << "Failed to prepare compressSql: "
-                      << sqlite3_errmsg(db) << "\n";
         }
-    }
 
-    {
-        const char* deleteSql = "DELETE FROM Snapshots WHERE timestamp < ?;";
-        sqlite3_stmt* stmt = nullptr;
-        if (sqlite3_prepare_v2(db, deleteSql, -1, &stmt, nullptr) == SQLITE_OK)
+        bool empty = false;
         {
-            sqlite3_bind_int64(stmt, 1, static_cast<sqlite3_int64>(cutoffTimestamp));
-            int rc = sqlite3_step(stmt);
-            if (rc != SQLITE_DONE)
+            CachedStatement stmt(writerStatements.get(table.countSql));
+            if (stmt && sqlite3_step(stmt.get()) == SQLITE_ROW)
             {
-                std::cerr << "Prune delete failed: "
-                          << sqlite3_errmsg(db) << "\n";
+                bool anyRows = true;
+                SqlBind::readAll(stmt.get(), anyRows);
+                empty = !anyRows;
             }
-            sqlite3_finalize(stmt);
         }
-        else
+
+        if (empty)
         {
-            std::cerr << "Failed to prepare deleteSql: "
-                      << sqlite3_errmsg(db) << "\n";
+            std::cout << "[System] Dropping empty pre-partitioning table " << table.partitions.family() << "." << std::endl;
+            table.partitions.dropLegacy();
         }
-    }
 
-    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+        sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+    }
 }
 
 
-void SQLiteStore::importStaticSchedule(std::string const& csvPath) {
-    std::lock_guard<std::mutex> lock(mutex);
+bool SQLiteStore::execSql(const char* sql)
+{
+    char* errMsg = nullptr;
+    if (sqlite3_exec(db, sql, nullptr, nullptr, &errMsg) != SQLITE_OK)
+    {
+        std::cerr << "SQL failed: " << (errMsg ? errMsg : "unknown error") << "\n";
+        if (errMsg) sqlite3_free(errMsg);
+        return false;
+    }
+    return true;
+}
+
+bool SQLiteStore::hasColumn(const char* table, const char* column)
+{
+    std::string sql = std::string("PRAGMA table_info(") + table + ")";
+    bool found = false;
 
-    sqlite3_stmt* checkStmt;
-    sqlite3_prepare_v2(db, "SELECT count(*) FROM StaticSchedule", -1, &checkStmt, nullptr);
-    if (sqlite3_step(checkStmt) == SQLITE_ROW) {
-        int count = sqlite3_column_int(checkStmt, 0);
-        sqlite3_finalize(checkStmt);
-        if (count > 0) {
-            std::cout << "[System] Static Schedule already loaded (" << count << " rows)." << std::endl;
-            return; 
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) == SQLITE_OK)
+    {
+        while (sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            const unsigned char* name = sqlite3_column_text(stmt, 1);
+            if (name && std::string(reinterpret_cast<const char*>(name)) == column)
+                found = true;
         }
-    } else {
-        sqlite3_finalize(checkStmt);
     }
+    sqlite3_finalize(stmt);
+    return found;
+}
 
-    std::cout << "[System] Importing " << csvPath << " (This may take a minute)..." << std::endl;
-
-    const char* createSql = 
-        "CREATE TABLE IF NOT EXISTS StaticSchedule ("
-        "trip_id TEXT, "
-        "stop_id TEXT, "
-        "arrival_sec INTEGER, "
-        "PRIMARY KEY (trip_id, stop_id));";
-    sqlite3_exec(db, createSql, nullptr, nullptr, nullptr);
+void SQLiteStore::runMigrations()
+{
+    struct Migration
+    {
+        int version;
+        const char* description;
+        std::function<bool()> apply;
+    };
 
-    std::ifstream file(csvPath);
-    if (!file.is_open()) {
-        std::cerr << "ERROR: Could not open " << csvPath << std::endl;
-        return;
-    }
+    // Append only: a released migration is never edited or reordered.
+    const std::vector<Migration> migrations = {
+        { 1, "create StationMetrics and StaticSchedule", [this]()
+        {
+            return execSql(
+                "CREATE TABLE IF NOT EXISTS StationMetrics ("
+                "  stationId TEXT, "
+                "  date TEXT, "
+                "  totalStalls INTEGER, "
+                "  avgDwellTime REAL, "
+                "  maxDwellTime INTEGER, "
+                "  PRIMARY KEY (stationId, date)"
+                ");"
+                "CREATE TABLE IF NOT EXISTS StaticSchedule ("
+                "  trip_id TEXT, "
+                "  stop_id TEXT, "
+                "  arrival_sec INTEGER, "
+                "  match_key TEXT, "
+                "  PRIMARY KEY (trip_id, stop_id)"
+                ");");
+        } },
+        { 2, "match_key lookup index on StaticSchedule", [this]()
+        {
+            // Schedules imported before match_key existed get the column and are backfilled.
+            if (!hasColumn("StaticSchedule", "match_key") &&
+                !execSql("ALTER TABLE StaticSchedule ADD COLUMN match_key TEXT;"
+                         "UPDATE StaticSchedule SET match_key = tpa_trip_key(trip_id);"))
+                return false;
 
-    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
-    sqlite3_stmt* insertStmt;
-    sqlite3_prepare_v2(db, "INSERT OR IGNORE INTO StaticSchedule VALUES (?, ?, ?)", -1, &insertStmt, nullptr);
+            return execSql("CREATE INDEX IF NOT EXISTS idx_schedule_match ON StaticSchedule(match_key, stop_id);");
+        } },
+        { 3, "recent-stall covering index on snapshot partitions", [this]()
+        {
+            return snapshotPartitions.applyToAll(SNAPSHOT_RECENT_INDEX);
+        } },
+        { 4, "recent-stall and open-interval indexes on interval partitions", [this]()
+        {
+            return intervalPartitions.applyToAll(INTERVAL_RECENT_INDEX) &&
+                   intervalPartitions.applyToAll(INTERVAL_OPEN_INDEX);
+        } },
+        { 5, "prune cutoff indexes on pre-partitioning tables", [this]()
+        {
+            if (snapshotPartitions.hasLegacy() &&
+                !execSql("CREATE INDEX IF NOT EXISTS idx_snapshots_timestamp ON Snapshots(timestamp);"))
+                return false;
+            if (intervalPartitions.hasLegacy() &&
+                !execSql("CREATE INDEX IF NOT EXISTS idx_intervals_lastSeen ON Intervals(lastSeen);"))
+                return false;
+            return true;
+        } },
+        { 6, "hourly dwell sketches per station and route", [this]()
+        {
+            return execSql(
+                "CREATE TABLE IF NOT EXISTS DwellSketches ("
+                "  hourStart INTEGER, "
+                "  stationId TEXT, "
+                "  routeId TEXT, "
+                "  stalls INTEGER, "
+                "  sketch BLOB, "
+                "  PRIMARY KEY (hourStart, stationId, routeId)"
+                ") WITHOUT ROWID;");
+        } },
+        { 7, "drop StaticSchedule (schedule lookups are served from memory)", [this]()
+        {
+            return execSql("DROP INDEX IF EXISTS idx_schedule_match;"
+                           "DROP TABLE IF EXISTS StaticSchedule;");
+        } },
+    };
 
-    std::string line;
-    std::getline(file, line); 
+    execSql("CREATE TABLE IF NOT EXISTS schema_version ("
+            "  version INTEGER PRIMARY KEY, "
+            "  description TEXT, "
+            "  appliedAt INTEGER"
+            ");");
 
-    int count = 0;
-    while (std::getline(file, line))
+    int current = 0;
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, "SELECT COALESCE(MAX(version), 0) FROM schema_version;", -1, &stmt, nullptr) == SQLITE_OK &&
+        sqlite3_step(stmt) == SQLITE_ROW)
     {
-        std::stringstream ss(line);
-        std::string segment;
-        std::vector<std::string> row;
-        
-        while (std::getline(ss, segment, ',')) {
-            row.push_back(segment);
-        }
-        if (row.size() < 4) continue;
+        current = sqlite3_column_int(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
 
-        std::string tripId = row[0];
-        std::string stopId = row[1]; 
-        std::string timeStr = row[2]; 
+    for (Migration const& migration : migrations)
+    {
+        if (migration.version <= current)
+            continue;
 
+        std::cout << "[System] Applying schema migration " << migration.version
+                  << ": " << migration.description << "..." << std::endl;
 
-        int h = 0, m = 0, s = 0;
-        if (sscanf(timeStr.c_str(), "%d:%d:%d", &h, &m, &s) == 3) {
-            int totalSeconds = (h * 3600) + (m * 60) + s;
+        execSql("BEGIN TRANSACTION;");
+        if (!migration.apply())
+        {
+            execSql("ROLLBACK;");
+            std::cerr << "Schema migration " << migration.version << " failed; staying at version "
+                      << current << ".\n";
+            return;
+        }
 
-            sqlite3_bind_text(insertStmt, 1, tripId.c_str(), -1, SQLITE_TRANSIENT);
-            sqlite3_bind_text(insertStmt, 2, stopId.c_str(), -1, SQLITE_TRANSIENT);
-            sqlite3_bind_int(insertStmt, 3, totalSeconds);
-            
-            sqlite3_step(insertStmt);
-            sqlite3_reset(insertStmt);
-            count++;
+        stmt = nullptr;
+        if (sqlite3_prepare_v2(db, "INSERT INTO schema_version (version, description, appliedAt) VALUES (?, ?, ?);",
+                               -1, &stmt, nullptr) == SQLITE_OK)
+        {
+            sqlite3_bind_int(stmt, 1, migration.version);
+            sqlite3_bind_text(stmt, 2, migration.description, -1, SQLITE_STATIC);
+            sqlite3_bind_int64(stmt, 3, static_cast<sqlite3_int64>(std::time(nullptr)));
+            sqlite3_step(stmt);
         }
-    }
+        sqlite3_finalize(stmt);
 
-    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
-    sqlite3_finalize(insertStmt);
-    
-    std::cout << "[System] Import Complete. Loaded " << count << " scheduled stops." << std::endl;
+        execSql("COMMIT;");
+        current = migration.version;
+    }
 }
 
-int SQLiteStore::getScheduledTime(std::string const& tripId, std::string const& stopId) {
+void SQLiteStore::checkQueryPlans()
+{
+    struct HotQuery
+    {
+        const char* name;
+        std::string sql;
+    };
+
+    std::vector<HotQuery> queries = {
+        { "recent stalls (snapshots)", withTable(SNAPSHOT_SEED_SQL, snapshotPartitions.newest()) },
+        { "recent stalls (intervals)", withTable(INTERVAL_SEED_SQL, intervalPartitions.newest()) },
+        { "open intervals",            withTable(OPEN_INTERVAL_SQL, intervalPartitions.newest()) },
+        { "dwell percentiles",         DWELL_SKETCH_RANGE_SQL },
+    };
+    if (snapshotPartitions.hasLegacy())
+        queries.push_back({ "prune cutoff (Snapshots)", "DELETE FROM Snapshots WHERE timestamp < ?;" });
+    if (intervalPartitions.hasLegacy())
+        queries.push_back({ "prune cutoff (Intervals)", "DELETE FROM Intervals WHERE lastSeen < ?;" });
+
+    // A SCAN that isn't through an index means a hot query reads the whole table.
+    int unindexed = 0;
+    for (HotQuery const& query : queries)
+    {
+        std::string sql = "EXPLAIN QUERY PLAN " + query.sql;
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK)
+        {
+            std::cerr << "Failed to explain " << query.name << ": " << sqlite3_errmsg(db) << "\n";
+            continue;
+        }
 
-    std::string sql = "SELECT arrival_sec FROM StaticSchedule WHERE trip_id = ? AND stop_id = ?";
-    sqlite3_stmt* stmt;
-    int result = -1;
+        std::cout << "[System] Query plan for " << query.name << ":\n";
+        while (sqlite3_step(stmt) == SQLITE_ROW)
+        {
+            const unsigned char* text = sqlite3_column_text(stmt, 3);
+            std::string detail = text ? reinterpret_cast<const char*>(text) : "";
+            std::cout << "   " << detail << "\n";
 
-    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, nullptr) == SQLITE_OK) {
-        sqlite3_bind_text(stmt, 1, tripId.c_str(), -1, SQLITE_TRANSIENT);
-        sqlite3_bind_text(stmt, 2, stopId.c_str(), -1, SQLITE_TRANSIENT);
-        
-        if (sqlite3_step(stmt) == SQLITE_ROW) {
-            result = sqlite3_column_int(stmt, 0);
+            if (detail.rfind("SCAN ", 0) == 0 && detail.find("INDEX") == std::string::npos)
+            {
+                std::cerr << "Warning: " << query.name << " scans without an index: " << detail << "\n";
+                ++unindexed;
+            }
         }
+        sqlite3_finalize(stmt);
     }
-    sqlite3_finalize(stmt);
-    return result;
-}
\ No newline at end of file
+
+    if (unindexed == 0)
+        std::cout << "[System] All hot queries are index-backed." << std::endl;
+}
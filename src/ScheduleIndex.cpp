@@ -0,0 +1,225 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <tuple>
+#include <unordered_map>
+#include "BinaryIO.hpp"
+#include "ScheduleIndex.hpp"
+#include "TripCalendar.hpp"
+#include "TripKey.hpp"
+
+namespace
+{
+    // Sorts and dedupes values, appends them to strings and returns each one's index.
+    std::unordered_map<std::string_view, std::uint32_t> writeTable(std::vector<std::string_view>& values,
+                                                                   std::string& strings,
+                                                                   std::vector<std::uint32_t>& bounds)
+    {
+        std::sort(values.begin(), values.end());
+        values.erase(std::unique(values.begin(), values.end()), values.end());
+
+        std::unordered_map<std::string_view, std::uint32_t> indexOf;
+        indexOf.reserve(values.size());
+        bounds.reserve(values.size() + 1);
+        for (std::string_view value : values)
+        {
+            indexOf.emplace(value, static_cast<std::uint32_t>(bounds.size()));
+            bounds.push_back(static_cast<std::uint32_t>(strings.size()));
+            strings.append(value);
+        }
+        bounds.push_back(static_cast<std::uint32_t>(strings.size()));
+        return indexOf;
+    }
+
+    bool validTable(std::vector<std::uint32_t> const& bounds, std::size_t poolSize)
+    {
+        return !bounds.empty() && std::is_sorted(bounds.begin(), bounds.end()) && bounds.back() <= poolSize;
+    }
+
+    template <typename T>
+    void putArray(std::string& out, std::vector<T> const& values)
+    {
+        BinaryIO::put(out, static_cast<std::uint32_t>(values.size()));
+        out.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+    }
+
+    template <typename T>
+    bool getArray(BinaryIO::Reader& reader, std::vector<T>& values)
+    {
+        auto count = reader.get<std::uint32_t>();
+        std::string_view raw = reader.getBytes(static_cast<std::size_t>(count) * sizeof(T));
+        if (!reader.ok())
+            return false;
+
+        values.resize(count);
+        std::copy(raw.begin(), raw.end(), reinterpret_cast<char*>(values.data()));
+        return true;
+    }
+}
+
+ScheduleIndex ScheduleIndex::build(std::vector<ScheduledStop> const& rows, TripCalendar const& calendar, ServiceDay const& serviceDay)
+{
+    ScheduleIndex index;
+    index.day = serviceDay;
+
+    const ServiceDay yesterday = serviceDay.previous();
+    const auto dayLength = static_cast<std::int32_t>(serviceDay.start - yesterday.start);    // 23h or 25h across DST
+
+    // Which days each trip counts for is decided once per trip, not per row.
+    struct Trip
+    {
+        std::string key;
+        std::int32_t lastArrival = -1;
+        bool today = false;
+        bool carried = false;    // yesterday's service, still running after midnight
+    };
+    std::unordered_map<std::string_view, Trip> trips;
+    for (ScheduledStop const& row : rows)
+    {
+        Trip& trip = trips[row.tripId];
+        trip.lastArrival = std::max(trip.lastArrival, static_cast<std::int32_t>(row.arrivalSec));
+    }
+
+    std::size_t todayTrips = 0, carriedTrips = 0;
+    for (auto& [tripId, trip] : trips)
+    {
+        trip.today = calendar.runsOn(tripId, serviceDay);
+        trip.carried = trip.lastArrival >= dayLength && calendar.runsOn(tripId, yesterday);
+        if (trip.today || trip.carried)
+            trip.key = TripKey::normalize(tripId);
+
+        todayTrips += trip.today;
+        carriedTrips += trip.carried;
+    }
+
+    struct Pending
+    {
+        std::string_view key;
+        std::string_view stop;
+        std::int32_t arrivalSec;
+    };
+    std::vector<Pending> pending;
+    std::vector<std::string_view> keys, stops;
+    for (ScheduledStop const& row : rows)
+    {
+        if (row.arrivalSec < 0)
+            continue;
+
+        Trip const& trip = trips.find(row.tripId)->second;
+        if (trip.today)
+            pending.push_back({ trip.key, row.stopId, row.arrivalSec });
+        if (trip.carried && row.arrivalSec >= dayLength)
+            pending.push_back({ trip.key, row.stopId, row.arrivalSec - dayLength });
+    }
+    keys.reserve(pending.size());
+    stops.reserve(pending.size());
+    for (Pending const& p : pending)
+    {
+        keys.push_back(p.key);
+        stops.push_back(p.stop);
+    }
+
+    auto keyIndex = writeTable(keys, index.strings, index.keyBounds);
+    auto stopIndex = writeTable(stops, index.strings, index.stopBounds);
+
+    index.entries.reserve(pending.size());
+    for (Pending const& p : pending)
+        index.entries.push_back({ keyIndex[p.key], stopIndex[p.stop], p.arrivalSec });
+
+    auto order = [](Entry const& a, Entry const& b)
+    {
+        return std::tie(a.key, a.stop, a.arrivalSec) < std::tie(b.key, b.stop, b.arrivalSec);
+    };
+    auto same = [](Entry const& a, Entry const& b)
+    {
+        return a.key == b.key && a.stop == b.stop && a.arrivalSec == b.arrivalSec;
+    };
+    std::sort(index.entries.begin(), index.entries.end(), order);
+    index.entries.erase(std::unique(index.entries.begin(), index.entries.end(), same), index.entries.end());
+    index.entries.shrink_to_fit();
+    index.strings.shrink_to_fit();
+
+    std::cout << "Indexed " << todayTrips << " trips for " << serviceDay.label() << " and "
+              << carriedTrips << " still running from the day before." << std::endl;
+    return index;
+}
+
+std::int64_t ScheduleIndex::find(std::vector<std::uint32_t> const& bounds, std::string_view value) const
+{
+    std::size_t low = 0, high = bounds.empty() ? 0 : bounds.size() - 1;
+    while (low < high)
+    {
+        std::size_t mid = low + (high - low) / 2;
+        if (text(bounds, mid) < value)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return (low + 1 < bounds.size() && text(bounds, low) == value) ? static_cast<std::int64_t>(low) : -1;
+}
+
+std::int64_t ScheduleIndex::lookup(std::string_view tripId, std::string_view stopId, std::int64_t seenAt) const
+{
+    std::int64_t key = find(keyBounds, TripKey::normalize(tripId));
+    std::int64_t stop = key < 0 ? -1 : find(stopBounds, stopId);
+    if (stop < 0)
+        return -1;
+
+    Entry target{ static_cast<std::uint32_t>(key), static_cast<std::uint32_t>(stop), 0 };
+    auto [first, last] = std::equal_range(entries.begin(), entries.end(), target, [](Entry const& a, Entry const& b)
+    {
+        return std::tie(a.key, a.stop) < std::tie(b.key, b.stop);
+    });
+
+    std::int64_t best = -1;
+    for (auto it = first; it != last; ++it)
+    {
+        std::int64_t scheduled = day.start + it->arrivalSec;
+        if (best < 0 || std::llabs(scheduled - seenAt) < std::llabs(best - seenAt))
+            best = scheduled;
+    }
+    return best;
+}
+
+void ScheduleIndex::serialize(std::string& out) const
+{
+    BinaryIO::put(out, day.localDate);
+    BinaryIO::put(out, day.start);
+    BinaryIO::put(out, static_cast<std::int32_t>(day.weekday));
+    BinaryIO::putString(out, strings);
+    putArray(out, keyBounds);
+    putArray(out, stopBounds);
+    putArray(out, entries);
+}
+
+bool ScheduleIndex::restore(std::string_view bytes)
+{
+    BinaryIO::Reader reader(bytes);
+    ServiceDay restoredDay;
+    restoredDay.localDate = reader.get<std::int64_t>();
+    restoredDay.start = reader.get<std::int64_t>();
+    restoredDay.weekday = reader.get<std::int32_t>();
+    std::string_view pool = reader.getString();
+
+    std::vector<std::uint32_t> restoredKeys, restoredStops;
+    std::vector<Entry> restoredEntries;
+    if (!getArray(reader, restoredKeys) || !getArray(reader, restoredStops) || !getArray(reader, restoredEntries) ||
+        !reader.atEnd())
+        return false;
+
+    if (!validTable(restoredKeys, pool.size()) || !validTable(restoredStops, pool.size()) ||
+        restoredDay.weekday < 0 || restoredDay.weekday > 6)
+        return false;
+    for (Entry const& entry : restoredEntries)
+    {
+        if (std::size_t{ entry.key } + 1 >= restoredKeys.size() || std::size_t{ entry.stop } + 1 >= restoredStops.size())
+            return false;
+    }
+
+    day = restoredDay;
+    strings.assign(pool);
+    keyBounds = std::move(restoredKeys);
+    stopBounds = std::move(restoredStops);
+    entries = std::move(restoredEntries);
+    return true;
+}
@@ -0,0 +1,55 @@
+#include <chrono>
+#include <cstdio>
+#include <date/tz.h>
+#include "ServiceDay.hpp"
+
+namespace
+{
+    date::time_zone const* newYork()
+    {
+        static date::time_zone const* zone = date::locate_zone("America/New_York");
+        return zone;
+    }
+
+    const char* WEEKDAY_NAMES[7] = { "Sunday", "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday" };
+}
+
+ServiceDay ServiceDay::ofDate(std::int64_t localDate)
+{
+    date::local_days midnight{ date::days{ localDate } };
+    auto noon = newYork()->to_sys(midnight + std::chrono::hours(12), date::choose::earliest);
+
+    ServiceDay day;
+    day.localDate = localDate;
+    day.start = std::chrono::duration_cast<std::chrono::seconds>(noon.time_since_epoch()).count() - 12 * 3600;
+    day.weekday = static_cast<int>(date::weekday{ midnight }.c_encoding());
+    return day;
+}
+
+ServiceDay ServiceDay::containing(std::time_t when)
+{
+    date::zoned_time local{ newYork(), std::chrono::system_clock::from_time_t(when) };
+    auto midnight = date::floor<date::days>(local.get_local_time());
+    return ofDate(midnight.time_since_epoch().count());
+}
+
+bool ServiceDay::runs(std::string_view serviceId) const
+{
+    if (serviceId.find("Saturday") != std::string_view::npos)
+        return weekday == 6;
+    if (serviceId.find("Sunday") != std::string_view::npos)
+        return weekday == 0;
+    if (serviceId.find("Weekday") != std::string_view::npos)
+        return weekday >= 1 && weekday <= 5;
+    return true;
+}
+
+std::string ServiceDay::label() const
+{
+    date::year_month_day ymd{ date::local_days{ date::days{ localDate } } };
+
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%04d-%02u-%02u (%s)", static_cast<int>(ymd.year()),
+                  static_cast<unsigned>(ymd.month()), static_cast<unsigned>(ymd.day()), WEEKDAY_NAMES[weekday]);
+    return buffer;
+}
@@ -0,0 +1,117 @@
+#include <chrono>
+#include <iostream>
+#include "SnapshotWriter.hpp"
+#include "SQLiteStore.hpp"
+
+SnapshotWriter::SnapshotWriter(SQLiteStore& store)
+    : db(store)
+    , worker([this]() { run(); })
+{
+}
+
+SnapshotWriter::~SnapshotWriter()
+{
+    Job stop;
+    stop.kind = Job::Kind::Stop;
+    queue.push(std::move(stop));
+
+    if (worker.joinable())
+        worker.join();
+}
+
+void SnapshotWriter::submit(std::vector<TrainSnapshot> batch)
+{
+    if (batch.empty())
+        return;
+
+    Job job;
+    job.batch = std::move(batch);
+    queue.push(std::move(job));
+}
+
+void SnapshotWriter::endCycle()
+{
+    Job job;
+    job.kind = Job::Kind::EndCycle;
+    queue.push(std::move(job));
+}
+
+void SnapshotWriter::requestPrune(int daysToKeep)
+{
+    Job job;
+    job.kind = Job::Kind::Prune;
+    job.daysToKeep = daysToKeep;
+    queue.push(std::move(job));
+}
+
+WriterStats SnapshotWriter::getStats() const noexcept
+{
+    WriterStats stats;
+    stats.queueDepth        = queue.size();
+    stats.commits           = commits.load(std::memory_order_relaxed);
+    stats.lastCommitRows    = lastCommitRows.load(std::memory_order_relaxed);
+    stats.lastCommitBatches = lastCommitBatches.load(std::memory_order_relaxed);
+    stats.lastCommitMicros  = lastCommitMicros.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void SnapshotWriter::commit(std::vector<std::vector<TrainSnapshot>>& pending)
+{
+    if (pending.empty())
+        return;
+
+    std::size_t rows = 0;
+    for (auto const& batch : pending)
+        rows += batch.size();
+
+    auto started = std::chrono::steady_clock::now();
+    db.insertBatches(pending);
+    auto elapsed = std::chrono::steady_clock::now() - started;
+
+    lastCommitRows.store(rows, std::memory_order_relaxed);
+    lastCommitBatches.store(pending.size(), std::memory_order_relaxed);
+    lastCommitMicros.store(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count(), std::memory_order_relaxed);
+    commits.fetch_add(1, std::memory_order_relaxed);
+
+    pending.clear();
+}
+
+void SnapshotWriter::run()
+{
+    std::vector<std::vector<TrainSnapshot>> pending;
+
+    for (;;)
+    {
+        std::uint64_t seen = queue.pushCount();
+        std::optional<Job> job = queue.pop();
+        if (!job)
+        {
+            queue.waitForPushAfter(seen);
+            continue;
+        }
+
+        switch (job->kind)
+        {
+            case Job::Kind::Batch:
+                pending.push_back(std::move(job->batch));
+                break;
+
+            case Job::Kind::EndCycle:
+                // A cycle with nothing new still moves the stall list on to the current time.
+                if (pending.empty())
+                    db.refreshStalls();
+                else
+                    commit(pending);
+                break;
+
+            case Job::Kind::Prune:
+                commit(pending);
+                db.pruneOldData(job->daysToKeep);
+                break;
+
+            case Job::Kind::Stop:
+                commit(pending);
+                return;
+        }
+    }
+}
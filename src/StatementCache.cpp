@@ -0,0 +1,50 @@
+#include <iostream>
+#include "StatementCache.hpp"
+
+StatementCache::StatementCache(sqlite3* connection)
+    : handle(connection)
+{
+}
+
+StatementCache::~StatementCache()
+{
+    clear();
+}
+
+StatementCache::StatementCache(StatementCache&& other) noexcept
+    : handle(other.handle)
+    , statements(std::move(other.statements))
+{
+    other.statements.clear();
+}
+
+void StatementCache::setConnection(sqlite3* connection)
+{
+    clear();
+    handle = connection;
+}
+
+sqlite3_stmt* StatementCache::get(const char* sql)
+{
+    auto it = statements.find(sql);
+    if (it != statements.end())
+        return it->second;
+
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v3(handle, sql, -1, SQLITE_PREPARE_PERSISTENT, &stmt, nullptr) != SQLITE_OK)
+    {
+        std::cerr << "Failed to prepare cached statement: " << sqlite3_errmsg(handle) << "\n";
+        sqlite3_finalize(stmt);
+        return nullptr;
+    }
+
+    statements.emplace(sql, stmt);
+    return stmt;
+}
+
+void StatementCache::clear()
+{
+    for (auto& [sql, stmt] : statements)
+        sqlite3_finalize(stmt);
+    statements.clear();
+}
@@ -0,0 +1,174 @@
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include "BinaryIO.hpp"
+#include "CsvReader.hpp"
+#include "Parser.hpp"
+#include "StaticData.hpp"
+#include "StopTimes.hpp"
+#include "TripCalendar.hpp"
+#include "VirtualClock.hpp"
+
+StaticGeneration::~StaticGeneration()
+{
+    if (number > 0)
+        std::cout << "[System] Released static data generation " << number << "." << std::endl;
+}
+
+StaticData::StaticData(std::string stopsFile, std::string stopTimesFile, std::string tripsFile)
+    : stopsPath(std::move(stopsFile))
+    , stopTimesPath(std::move(stopTimesFile))
+    , tripsPath(std::move(tripsFile))
+{
+}
+
+StaticData::~StaticData()
+{
+    std::lock_guard<std::mutex> lock(reloadMutex);
+    if (reloadThread.joinable())
+        reloadThread.join();
+}
+
+std::shared_ptr<const StaticGeneration> StaticData::current() const
+{
+    return generation.load(std::memory_order_acquire);
+}
+
+void StaticData::publish(std::shared_ptr<const StaticGeneration> next)
+{
+    generation.store(std::move(next), std::memory_order_release);
+}
+
+std::uint64_t StaticData::hashSources() const
+{
+    // Contents plus sizes, so a reordered or truncated file never collides with the original.
+    std::uint64_t hash = BinaryIO::fnv1a({});
+    for (std::string const* source : { &stopsPath, &stopTimesPath, &tripsPath })
+    {
+        MappedFile mapped(*source);
+        hash = BinaryIO::fnv1a(mapped.view(), hash);
+
+        std::string size;
+        BinaryIO::put(size, static_cast<std::uint64_t>(mapped.view().size()));
+        hash = BinaryIO::fnv1a(size, hash);
+    }
+    return hash;
+}
+
+std::shared_ptr<StaticGeneration> StaticData::build(std::uint64_t number, std::uint64_t sourceHash,
+                                                     ServiceDay const& serviceDay) const
+{
+    auto next = std::make_shared<StaticGeneration>();
+    next->number = number;
+    next->sourceHash = sourceHash;
+
+    std::ostringstream report;
+    auto started = std::chrono::steady_clock::now();
+    auto phase = [&started, &report](const char* name)
+    {
+        auto now = std::chrono::steady_clock::now();
+        auto micros = std::chrono::duration_cast<std::chrono::microseconds>(now - started).count();
+        started = now;
+        report << (report.tellp() > 0 ? ", " : "") << name << " " << micros / 1000.0 << " ms";
+    };
+
+    next->stops = StopManager(stopsPath);
+    phase("stops.txt");
+
+    // stop_times.txt is read once and shared by terminal detection and the schedule index.
+    StopTimes stopTimes(stopTimesPath);
+    phase("stop_times.txt");
+    report << " (" << stopTimes.chunkCount() << " chunks)";
+
+    next->stops.loadTerminals(Parser::detectTerminals(stopTimes, next->stops));
+    phase("terminals");
+
+    TripCalendar calendar(tripsPath);
+    phase("trips.txt");
+
+    next->schedule = ScheduleIndex::build(stopTimes.rows(), calendar, serviceDay);
+    phase("schedule index");
+
+    std::cout << "[System] Built static data generation " << number << ": " << report.str() << "; "
+              << next->schedule.size() << " scheduled stops for " << serviceDay.label() << " in "
+              << next->schedule.memoryBytes() / 1024 << " KiB." << std::endl;
+
+    return next;
+}
+
+bool StaticData::requestReload()
+{
+    std::lock_guard<std::mutex> lock(reloadMutex);
+    if (reloading.exchange(true))
+        return false;
+
+    if (reloadThread.joinable())
+        reloadThread.join();
+
+    reloadThread = std::thread([this]() { reload(); });
+    return true;
+}
+
+bool StaticData::ensureServiceDay(std::time_t now)
+{
+    auto generation = current();
+    ServiceDay serviceDay = ServiceDay::containing(now);
+    if (!generation || generation->schedule.serviceDay() == serviceDay ||
+        serviceDay.localDate == emptyDate.load())
+        return false;
+    return requestReload();
+}
+
+bool StaticData::rebuildNow(std::time_t now)
+{
+    std::lock_guard<std::mutex> lock(reloadMutex);
+    if (reloadThread.joinable())
+        reloadThread.join();
+
+    ServiceDay serviceDay = ServiceDay::containing(now);
+    auto generation = current();
+    if (!generation || generation->schedule.serviceDay() == serviceDay)
+        return false;
+    generation.reset();
+
+    rebuild(serviceDay);
+    return true;
+}
+
+void StaticData::reload()
+{
+    rebuild(ServiceDay::containing(VirtualClock::now()));
+    reloading.store(false);
+}
+
+void StaticData::rebuild(ServiceDay const& serviceDay)
+{
+    auto previous = current();
+    std::uint64_t hash = hashSources();
+
+    if (previous && previous->sourceHash == hash && previous->schedule.serviceDay() == serviceDay)
+    {
+        std::cout << "[System] Static GTFS files unchanged; keeping generation " << previous->number << "." << std::endl;
+    }
+    else if (hash == emptyHash.load() && serviceDay.localDate == emptyDate.load())
+    {
+        std::cout << "[System] Static GTFS files unchanged since they last built empty; keeping generation "
+                  << (previous ? previous->number : 0) << "." << std::endl;
+    }
+    else
+    {
+        auto next = build(previous ? previous->number + 1 : 1, hash, serviceDay);
+
+        // A file caught mid-copy would otherwise drop every stop from ingest.
+        if (next->stops.size() == 0 || next->schedule.size() == 0)
+        {
+            std::cerr << "Static data generation " << next->number << " is empty; keeping the current one.\n";
+            emptyHash.store(hash);
+            emptyDate.store(serviceDay.localDate);
+        }
+        else
+        {
+            publish(std::move(next));
+        }
+    }
+}
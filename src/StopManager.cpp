@@ -1,34 +1,34 @@
 #include "StopManager.hpp"
 
 #include <iostream>
-#include <fstream>
-#include <sstream>
+#include "BinaryIO.hpp"
+#include "CsvReader.hpp"
 
 StopManager::StopManager(std::string const& filepath)
 {
-    std::ifstream file(filepath);
-    if (!file.is_open())
+    MappedFile file(filepath);
+    if (!file.isOpen())
     {
         std::cerr << "ERROR: Could not open " << filepath << " — StopManager unusable!\n";
         return;
     }
 
-    std::string line;
-    std::getline(file, line); 
+    CsvReader reader(file.view());
+    reader.readHeader();
 
-    while (std::getline(file, line))
-    {
-        if (line.empty()) continue;
+    const std::size_t stopIdColumn        = reader.column("stop_id", 0);
+    const std::size_t stopNameColumn      = reader.column("stop_name", 1);
+    const std::size_t locationTypeColumn  = reader.column("location_type", 4);
+    const std::size_t parentStationColumn = reader.column("parent_station", 5);
 
-        std::stringstream ss(line);
-        std::string stop_id, stop_name, lat, lon, location_type, parent_station;
+    while (reader.next())
+    {
+        std::string stop_id(reader.field(stopIdColumn));
+        if (stop_id.empty()) continue;
 
-        std::getline(ss, stop_id, ',');
-        std::getline(ss, stop_name, ',');
-        std::getline(ss, lat, ',');
-        std::getline(ss, lon, ',');
-        std::getline(ss, location_type, ',');
-        std::getline(ss, parent_station, ',');
+        std::string stop_name(reader.field(stopNameColumn));
+        std::string_view location_type = reader.field(locationTypeColumn);
+        std::string parent_station(reader.field(parentStationColumn));
 
         validStops.insert(stop_id);
 
@@ -102,3 +102,67 @@ void StopManager::loadTerminals(const std::unordered_set<std::string>& terminals
     std::cout << "Loaded " << terminalStations.size()
               << " terminal stations.\n";
 }
+
+void StopManager::serialize(std::string& out) const
+{
+    BinaryIO::put(out, static_cast<std::uint32_t>(parentOf.size()));
+    for (auto const& [stop, parent] : parentOf)
+    {
+        BinaryIO::putString(out, stop);
+        BinaryIO::putString(out, parent);
+    }
+
+    BinaryIO::put(out, static_cast<std::uint32_t>(stationNames.size()));
+    for (auto const& [station, name] : stationNames)
+    {
+        BinaryIO::putString(out, station);
+        BinaryIO::putString(out, name);
+    }
+
+    for (auto const* set : { &validStops, &terminalStations })
+    {
+        BinaryIO::put(out, static_cast<std::uint32_t>(set->size()));
+        for (std::string const& id : *set)
+            BinaryIO::putString(out, id);
+    }
+}
+
+bool StopManager::restore(std::string_view bytes)
+{
+    BinaryIO::Reader reader(bytes);
+
+    auto readMap = [&reader](std::unordered_map<std::string, std::string>& map)
+    {
+        auto count = reader.get<std::uint32_t>();
+        map.clear();
+        map.reserve(count);
+        for (std::uint32_t i = 0; i < count && reader.ok(); ++i)
+        {
+            std::string key(reader.getString());
+            map.emplace(std::move(key), reader.getString());
+        }
+    };
+
+    auto readSet = [&reader](std::unordered_set<std::string>& set)
+    {
+        auto count = reader.get<std::uint32_t>();
+        set.clear();
+        set.reserve(count);
+        for (std::uint32_t i = 0; i < count && reader.ok(); ++i)
+            set.emplace(reader.getString());
+    };
+
+    readMap(parentOf);
+    readMap(stationNames);
+    readSet(validStops);
+    readSet(terminalStations);
+
+    if (!reader.ok())
+        return false;
+
+    std::cout << "Loaded " << validStops.size()
+              << " stops (" << stationNames.size()
+              << " parent stations, " << terminalStations.size()
+              << " terminals) from warm start\n";
+    return true;
+}
@@ -0,0 +1,133 @@
+#include <algorithm>
+#include <charconv>
+#include <future>
+#include <thread>
+#include "StopTimes.hpp"
+
+namespace
+{
+    struct Columns
+    {
+        std::size_t tripId;
+        std::size_t stopId;
+        std::size_t arrival;
+    };
+
+    // Whole lines of body, for the n-th of count chunks.
+    std::string_view chunkOf(std::string_view body, std::size_t index, std::size_t count)
+    {
+        auto boundary = [body, count](std::size_t i)
+        {
+            if (i == 0)
+                return std::size_t{ 0 };
+            if (i >= count)
+                return body.size();
+
+            std::size_t at = body.size() / count * i;
+            std::size_t newline = body.find('\n', at);
+            return newline == std::string_view::npos ? body.size() : newline + 1;
+        };
+
+        std::size_t begin = boundary(index);
+        std::size_t end = std::max(begin, boundary(index + 1));
+        return body.substr(begin, end - begin);
+    }
+
+    std::vector<ScheduledStop> parseChunk(std::string_view chunk, Columns columns, std::deque<std::string>& unescaped)
+    {
+        std::vector<ScheduledStop> rows;
+        rows.reserve(chunk.size() / 64);
+
+        // Views into reader scratch don't outlive the record; those fields are copied out.
+        auto keep = [chunk, &unescaped](std::string_view field)
+        {
+            if (field.empty() || (field.data() >= chunk.data() && field.data() < chunk.data() + chunk.size()))
+                return field;
+            return std::string_view(unescaped.emplace_back(field));
+        };
+
+        CsvReader reader(chunk);
+        while (reader.next())
+        {
+            if (reader.size() == 1 && reader.field(0).empty())
+                continue;
+
+            ScheduledStop row;
+            row.tripId = keep(reader.field(columns.tripId));
+            row.stopId = keep(reader.field(columns.stopId));
+            row.arrivalSec = StopTimes::parseClock(reader.field(columns.arrival));
+            rows.push_back(row);
+        }
+        return rows;
+    }
+}
+
+int StopTimes::parseClock(std::string_view text)
+{
+    while (!text.empty() && text.front() == ' ')
+        text.remove_prefix(1);
+
+    int parts[3] = { 0, 0, 0 };
+    const char* cursor = text.data();
+    const char* end = text.data() + text.size();
+    for (int i = 0; i < 3; ++i)
+    {
+        auto [next, ec] = std::from_chars(cursor, end, parts[i]);
+        if (ec != std::errc())
+            return -1;
+        cursor = next;
+
+        if (i < 2)
+        {
+            if (cursor == end || *cursor != ':')
+                return -1;
+            ++cursor;
+        }
+    }
+    return parts[0] * 3600 + parts[1] * 60 + parts[2];
+}
+
+StopTimes::StopTimes(std::string const& path, std::size_t threads)
+    : file(path)
+{
+    if (!file.isOpen())
+        return;
+
+    std::string_view text = file.view();
+
+    CsvReader header(text);
+    if (!header.readHeader())
+        return;
+
+    // MTA's column order, for files without a usable header.
+    Columns columns{ header.column("trip_id", 0), header.column("stop_id", 1), header.column("arrival_time", 2) };
+    std::string_view body = text.substr(header.offset());
+
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    // Small files aren't worth a thread per chunk.
+    constexpr std::size_t MIN_CHUNK_BYTES = 1 << 20;
+    chunks = std::clamp<std::size_t>(body.size() / MIN_CHUNK_BYTES, 1, threads);
+    unescaped.resize(chunks);
+
+    std::vector<std::future<std::vector<ScheduledStop>>> parsed;
+    parsed.reserve(chunks);
+    for (std::size_t i = 0; i < chunks; ++i)
+    {
+        parsed.push_back(std::async(std::launch::async, parseChunk, chunkOf(body, i, chunks), columns, std::ref(unescaped[i])));
+    }
+
+    std::vector<std::vector<ScheduledStop>> results;
+    results.reserve(chunks);
+    std::size_t total = 0;
+    for (auto& future : parsed)
+    {
+        results.push_back(future.get());
+        total += results.back().size();
+    }
+
+    scheduledStops.reserve(total);
+    for (auto& rows : results)
+        scheduledStops.insert(scheduledStops.end(), rows.begin(), rows.end());
+}
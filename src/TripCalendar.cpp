@@ -0,0 +1,46 @@
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include "CsvReader.hpp"
+#include "TripCalendar.hpp"
+
+TripCalendar::TripCalendar(std::string const& path)
+{
+    MappedFile file(path);
+    if (!file.isOpen())
+    {
+        std::cerr << "Could not open " << path << "; schedules will not be filtered by service day.\n";
+        return;
+    }
+
+    CsvReader reader(file.view());
+    reader.readHeader();
+
+    const std::size_t tripIdColumn    = reader.column("trip_id", 1);
+    const std::size_t serviceIdColumn = reader.column("service_id", 2);
+
+    while (reader.next())
+    {
+        std::string_view tripId = reader.field(tripIdColumn);
+        std::string_view serviceId = reader.field(serviceIdColumn);
+        if (tripId.empty())
+            continue;
+
+        auto known = std::find(serviceIds.begin(), serviceIds.end(), serviceId);
+        if (known == serviceIds.end())
+        {
+            if (serviceIds.size() > std::numeric_limits<std::uint16_t>::max())
+                continue;
+            known = serviceIds.emplace(serviceIds.end(), serviceId);
+        }
+        serviceOfTrip.try_emplace(std::string(tripId), static_cast<std::uint16_t>(known - serviceIds.begin()));
+    }
+
+    std::cout << "Loaded " << serviceOfTrip.size() << " trips on " << serviceIds.size() << " service calendars." << std::endl;
+}
+
+bool TripCalendar::runsOn(std::string_view tripId, ServiceDay const& day) const
+{
+    auto it = serviceOfTrip.find(std::string(tripId));
+    return it == serviceOfTrip.end() || day.runs(serviceIds[it->second]);
+}
@@ -0,0 +1,16 @@
+#include "TripKey.hpp"
+
+std::string TripKey::normalize(std::string_view tripId)
+{
+    // Route is padded with dots to three characters, followed by the direction letter.
+    constexpr std::size_t ROUTE_AND_DIRECTION = 4;
+
+    std::size_t routeStart = tripId.rfind('_');
+    if (routeStart == std::string_view::npos || tripId.size() - routeStart - 1 < ROUTE_AND_DIRECTION)
+        return std::string(tripId);
+
+    std::size_t originStart = tripId.rfind('_', routeStart == 0 ? 0 : routeStart - 1);
+    originStart = (originStart == std::string_view::npos || originStart >= routeStart) ? 0 : originStart + 1;
+
+    return std::string(tripId.substr(originStart, routeStart - originStart + 1 + ROUTE_AND_DIRECTION));
+}
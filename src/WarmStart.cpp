@@ -0,0 +1,119 @@
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include "BinaryIO.hpp"
+#include "CsvReader.hpp"
+#include "SQLiteStore.hpp"
+#include "StaticData.hpp"
+#include "WarmStart.hpp"
+
+namespace
+{
+    constexpr char MAGIC[8] = { 'T', 'P', 'A', 'W', 'A', 'R', 'M', '\0' };
+    constexpr std::size_t HEADER_BYTES = sizeof(MAGIC) + sizeof(std::uint32_t) + 3 * sizeof(std::uint64_t);
+}
+
+WarmStart::WarmStart(std::string file)
+    : path(std::move(file))
+{
+}
+
+bool WarmStart::load(std::uint64_t expectedHash, StaticGeneration& generation, std::string& dwellState) const
+{
+    std::error_code ec;
+    if (!std::filesystem::exists(path, ec))
+        return false;
+
+    MappedFile file(path);
+    BinaryIO::Reader reader(file.view());
+
+    std::string_view magic = reader.getBytes(sizeof(MAGIC));
+    auto version     = reader.get<std::uint32_t>();
+    auto sourceHash  = reader.get<std::uint64_t>();
+    auto writtenAt   = reader.get<std::uint64_t>();
+    auto payloadHash = reader.get<std::uint64_t>();
+
+    if (!reader.ok() || magic != std::string_view(MAGIC, sizeof(MAGIC)) || version != FORMAT_VERSION)
+    {
+        std::cout << "[System] Ignoring warm-start file " << path << " (unknown format)." << std::endl;
+        return false;
+    }
+    if (sourceHash != expectedHash)
+    {
+        std::cout << "[System] Ignoring warm-start file " << path << " (GTFS files changed)." << std::endl;
+        return false;
+    }
+
+    if (BinaryIO::fnv1a(file.view().substr(HEADER_BYTES)) != payloadHash)
+    {
+        std::cerr << "Warm-start file " << path << " is damaged; rebuilding from GTFS.\n";
+        return false;
+    }
+
+    std::string_view stopSection = reader.getString();
+    std::string_view scheduleSection = reader.getString();
+    std::string_view dwellSection = reader.getString();
+    if (!reader.ok())
+        return false;
+
+    StopManager stops;
+    ScheduleIndex schedule;
+    if (!stops.restore(stopSection) || !schedule.restore(scheduleSection))
+    {
+        std::cerr << "Warm-start static data is unreadable; rebuilding from GTFS.\n";
+        return false;
+    }
+
+    generation.sourceHash = sourceHash;
+    generation.stops = std::move(stops);
+    generation.schedule = std::move(schedule);
+    dwellState.assign(dwellSection);
+
+    std::cout << "[System] Warm start from " << path << " (written "
+              << static_cast<long long>(std::time(nullptr)) - static_cast<long long>(writtenAt) << "s ago)." << std::endl;
+    return true;
+}
+
+bool WarmStart::save(StaticGeneration const& generation, SQLiteStore& db) const
+{
+    std::string stopSection;
+    generation.stops.serialize(stopSection);
+    std::string scheduleSection;
+    generation.schedule.serialize(scheduleSection);
+    std::string dwellSection = db.exportDwellState();
+
+    std::string payload;
+    BinaryIO::putString(payload, stopSection);
+    BinaryIO::putString(payload, scheduleSection);
+    BinaryIO::putString(payload, dwellSection);
+
+    std::string header(MAGIC, sizeof(MAGIC));
+    BinaryIO::put(header, FORMAT_VERSION);
+    BinaryIO::put(header, generation.sourceHash);
+    BinaryIO::put(header, static_cast<std::uint64_t>(std::time(nullptr)));
+    BinaryIO::put(header, BinaryIO::fnv1a(payload));
+
+    // A crash mid-write leaves the previous file in place.
+    std::string temp = path + ".tmp";
+    {
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        out.write(header.data(), static_cast<std::streamsize>(header.size()));
+        out.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+        if (!out)
+        {
+            std::cerr << "Failed to write warm-start file " << temp << "\n";
+            return false;
+        }
+    }
+
+    // Unlike std::rename on Windows, this replaces an existing file on every platform.
+    std::error_code ec;
+    std::filesystem::rename(temp, path, ec);
+    if (ec)
+    {
+        std::cerr << "Failed to replace warm-start file " << path << ": " << ec.message() << "\n";
+        return false;
+    }
+    return true;
+}
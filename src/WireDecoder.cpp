@@ -0,0 +1,404 @@
+#include "WireDecoder.hpp"
+
+namespace
+{
+    enum WireType : std::uint32_t
+    {
+        VARINT = 0,
+        FIXED64 = 1,
+        LENGTH_DELIMITED = 2,
+        FIXED32 = 5
+    };
+
+    // Field numbers from gtfs-realtime.proto and nyct-subway.proto.
+    namespace field
+    {
+        constexpr std::uint32_t FEED_HEADER = 1;
+        constexpr std::uint32_t FEED_ENTITY = 2;
+        constexpr std::uint32_t HEADER_TIMESTAMP = 3;
+
+        constexpr std::uint32_t ENTITY_TRIP_UPDATE = 3;
+        constexpr std::uint32_t ENTITY_VEHICLE = 4;
+
+        constexpr std::uint32_t TRIP_UPDATE_TRIP = 1;
+        constexpr std::uint32_t TRIP_UPDATE_STOP_TIME_UPDATE = 2;
+        constexpr std::uint32_t STOP_TIME_UPDATE_ARRIVAL = 2;
+        constexpr std::uint32_t STOP_TIME_UPDATE_DEPARTURE = 3;
+        constexpr std::uint32_t STOP_TIME_EVENT_DELAY = 1;
+
+        constexpr std::uint32_t VEHICLE_TRIP = 1;
+        constexpr std::uint32_t VEHICLE_CURRENT_STATUS = 4;
+        constexpr std::uint32_t VEHICLE_STOP_ID = 7;
+
+        constexpr std::uint32_t TRIP_ID = 1;
+        constexpr std::uint32_t TRIP_ROUTE_ID = 5;
+        constexpr std::uint32_t TRIP_NYCT_DESCRIPTOR = 1001;
+
+        constexpr std::uint32_t NYCT_TRAIN_ID = 1;
+        constexpr std::uint32_t NYCT_IS_ASSIGNED = 2;
+        constexpr std::uint32_t NYCT_DIRECTION = 3;
+    }
+
+    // Proto2 defaults the generated accessors fall back to.
+    constexpr std::int32_t DEFAULT_CURRENT_STATUS = 2;   // IN_TRANSIT_TO
+    constexpr std::int32_t DEFAULT_NYCT_DIRECTION = 1;   // NORTH
+
+    class Reader
+    {
+    private:
+        const std::uint8_t* pos;
+        const std::uint8_t* end;
+        bool valid = true;
+
+    public:
+        explicit Reader(std::string_view bytes)
+            : pos(reinterpret_cast<const std::uint8_t*>(bytes.data()))
+            , end(pos + bytes.size())
+        {}
+
+        bool ok() const { return valid; }
+        bool atEnd() const { return pos >= end; }
+
+        std::uint64_t varint()
+        {
+            std::uint64_t value = 0;
+            for (int shift = 0; shift < 64; shift += 7)
+            {
+                if (pos >= end)
+                    break;
+
+                std::uint8_t byte = *pos++;
+                value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+                if ((byte & 0x80) == 0)
+                    return value;
+            }
+            valid = false;
+            return 0;
+        }
+
+        // Reads the next tag; returns false at the end of the buffer or on malformed input.
+        bool next(std::uint32_t& fieldNumber, std::uint32_t& wireType)
+        {
+            if (!valid || atEnd())
+                return false;
+
+            std::uint64_t tag = varint();
+            fieldNumber = static_cast<std::uint32_t>(tag >> 3);
+            wireType    = static_cast<std::uint32_t>(tag & 0x7);
+            return valid && fieldNumber != 0;
+        }
+
+        std::string_view bytes()
+        {
+            std::uint64_t length = varint();
+            if (!valid || length > static_cast<std::uint64_t>(end - pos))
+            {
+                valid = false;
+                return {};
+            }
+
+            std::string_view out(reinterpret_cast<const char*>(pos), static_cast<std::size_t>(length));
+            pos += length;
+            return out;
+        }
+
+        void skip(std::uint32_t wireType)
+        {
+            switch (wireType)
+            {
+                case VARINT:           varint(); break;
+                case LENGTH_DELIMITED: bytes(); break;
+                case FIXED64:          advance(8); break;
+                case FIXED32:          advance(4); break;
+                default:               valid = false; break;
+            }
+        }
+
+    private:
+        void advance(std::size_t n)
+        {
+            if (static_cast<std::size_t>(end - pos) < n)
+            {
+                valid = false;
+                return;
+            }
+            pos += n;
+        }
+    };
+
+    // Fields of one TripDescriptor, with presence for the NYCT extension.
+    struct TripFields
+    {
+        std::string_view tripId;
+        std::string_view routeId;
+        bool hasNyct = false;
+        std::string_view trainId;
+        std::int32_t direction = DEFAULT_NYCT_DIRECTION;
+        bool isAssigned = false;
+    };
+
+    struct EntityFields
+    {
+        bool hasTripUpdate = false;
+        TripFields updateTrip;
+        bool hasDelay = false;
+        std::int32_t delay = 0;
+
+        bool hasVehicle = false;
+        TripFields vehicleTrip;
+        std::string_view stopId;
+        std::int32_t currentStatus = DEFAULT_CURRENT_STATUS;
+    };
+
+    bool decodeNyctDescriptor(std::string_view bytes, TripFields& trip)
+    {
+        Reader r(bytes);
+        std::uint32_t number = 0, wireType = 0;
+        trip.hasNyct = true;
+
+        while (r.next(number, wireType))
+        {
+            if (number == field::NYCT_TRAIN_ID && wireType == LENGTH_DELIMITED)
+                trip.trainId = r.bytes();
+            else if (number == field::NYCT_IS_ASSIGNED && wireType == VARINT)
+                trip.isAssigned = r.varint() != 0;
+            else if (number == field::NYCT_DIRECTION && wireType == VARINT)
+            {
+                // Values outside the enum go to unknown fields in the generated code.
+                std::uint64_t value = r.varint();
+                if (value >= 1 && value <= 4)
+                    trip.direction = static_cast<std::int32_t>(value);
+            }
+            else
+                r.skip(wireType);
+        }
+        return r.ok();
+    }
+
+    bool decodeTripDescriptor(std::string_view bytes, TripFields& trip)
+    {
+        Reader r(bytes);
+        std::uint32_t number = 0, wireType = 0;
+
+        while (r.next(number, wireType))
+        {
+            if (number == field::TRIP_ID && wireType == LENGTH_DELIMITED)
+                trip.tripId = r.bytes();
+            else if (number == field::TRIP_ROUTE_ID && wireType == LENGTH_DELIMITED)
+                trip.routeId = r.bytes();
+            else if (number == field::TRIP_NYCT_DESCRIPTOR && wireType == LENGTH_DELIMITED)
+            {
+                if (!decodeNyctDescriptor(r.bytes(), trip))
+                    return false;
+            }
+            else
+                r.skip(wireType);
+        }
+        return r.ok();
+    }
+
+    bool decodeStopTimeEventDelay(std::string_view bytes, bool& hasDelay, std::int32_t& delay)
+    {
+        Reader r(bytes);
+        std::uint32_t number = 0, wireType = 0;
+
+        while (r.next(number, wireType))
+        {
+            if (number == field::STOP_TIME_EVENT_DELAY && wireType == VARINT)
+            {
+                delay = static_cast<std::int32_t>(r.varint());
+                hasDelay = true;
+            }
+            else
+                r.skip(wireType);
+        }
+        return r.ok();
+    }
+
+    bool decodeStopTimeUpdate(std::string_view bytes, EntityFields& entity)
+    {
+        Reader r(bytes);
+        std::uint32_t number = 0, wireType = 0;
+        bool arrivalHasDelay = false, departureHasDelay = false;
+        std::int32_t arrivalDelay = 0, departureDelay = 0;
+
+        while (r.next(number, wireType))
+        {
+            if (number == field::STOP_TIME_UPDATE_ARRIVAL && wireType == LENGTH_DELIMITED)
+            {
+                if (!decodeStopTimeEventDelay(r.bytes(), arrivalHasDelay, arrivalDelay))
+                    return false;
+            }
+            else if (number == field::STOP_TIME_UPDATE_DEPARTURE && wireType == LENGTH_DELIMITED)
+            {
+                if (!decodeStopTimeEventDelay(r.bytes(), departureHasDelay, departureDelay))
+                    return false;
+            }
+            else
+                r.skip(wireType);
+        }
+
+        // Same precedence as Parser: arrival delay first, then departure.
+        if (arrivalHasDelay)
+        {
+            entity.hasDelay = true;
+            entity.delay = arrivalDelay;
+        }
+        else if (departureHasDelay)
+        {
+            entity.hasDelay = true;
+            entity.delay = departureDelay;
+        }
+        return r.ok();
+    }
+
+    bool decodeTripUpdate(std::string_view bytes, EntityFields& entity)
+    {
+        Reader r(bytes);
+        std::uint32_t number = 0, wireType = 0;
+        entity.hasTripUpdate = true;
+
+        while (r.next(number, wireType))
+        {
+            if (number == field::TRIP_UPDATE_TRIP && wireType == LENGTH_DELIMITED)
+            {
+                if (!decodeTripDescriptor(r.bytes(), entity.updateTrip))
+                    return false;
+            }
+            else if (number == field::TRIP_UPDATE_STOP_TIME_UPDATE && wireType == LENGTH_DELIMITED)
+            {
+                std::string_view update = r.bytes();
+                if (!entity.hasDelay && !decodeStopTimeUpdate(update, entity))
+                    return false;
+            }
+            else
+                r.skip(wireType);
+        }
+        return r.ok();
+    }
+
+    bool decodeVehicle(std::string_view bytes, EntityFields& entity)
+    {
+        Reader r(bytes);
+        std::uint32_t number = 0, wireType = 0;
+        entity.hasVehicle = true;
+
+        while (r.next(number, wireType))
+        {
+            if (number == field::VEHICLE_TRIP && wireType == LENGTH_DELIMITED)
+            {
+                if (!decodeTripDescriptor(r.bytes(), entity.vehicleTrip))
+                    return false;
+            }
+            else if (number == field::VEHICLE_STOP_ID && wireType == LENGTH_DELIMITED)
+                entity.stopId = r.bytes();
+            else if (number == field::VEHICLE_CURRENT_STATUS && wireType == VARINT)
+            {
+                std::uint64_t value = r.varint();
+                if (value <= 2)
+                    entity.currentStatus = static_cast<std::int32_t>(value);
+            }
+            else
+                r.skip(wireType);
+        }
+        return r.ok();
+    }
+
+    void applyNyct(TripFields const& trip, MergedTrip& m)
+    {
+        if (!trip.hasNyct)
+            return;
+
+        m.trainId    = trip.trainId;
+        m.direction  = trip.direction;
+        m.isAssigned = trip.isAssigned;
+    }
+
+    bool decodeEntity(std::string_view bytes, WireDecoder::TripMap& trips)
+    {
+        Reader r(bytes);
+        std::uint32_t number = 0, wireType = 0;
+        EntityFields entity;
+
+        while (r.next(number, wireType))
+        {
+            if (number == field::ENTITY_TRIP_UPDATE && wireType == LENGTH_DELIMITED)
+            {
+                if (!decodeTripUpdate(r.bytes(), entity))
+                    return false;
+            }
+            else if (number == field::ENTITY_VEHICLE && wireType == LENGTH_DELIMITED)
+            {
+                if (!decodeVehicle(r.bytes(), entity))
+                    return false;
+            }
+            else
+                r.skip(wireType);
+        }
+        if (!r.ok())
+            return false;
+
+        if (!entity.hasTripUpdate && !entity.hasVehicle)
+            return true;
+
+        std::string_view tripId = entity.hasTripUpdate ? entity.updateTrip.tripId : entity.vehicleTrip.tripId;
+        MergedTrip& snap = trips[tripId];
+        snap.tripId = tripId;
+
+        if (entity.hasTripUpdate)
+        {
+            snap.routeId = entity.updateTrip.routeId;
+            if (entity.hasDelay)
+                snap.delay = entity.delay;
+            applyNyct(entity.updateTrip, snap);
+        }
+
+        if (entity.hasVehicle)
+        {
+            snap.routeId       = entity.vehicleTrip.routeId;
+            snap.stopId        = entity.stopId;
+            snap.currentStatus = entity.currentStatus;
+            applyNyct(entity.vehicleTrip, snap);
+        }
+        return true;
+    }
+
+    bool decodeHeaderTimestamp(std::string_view bytes, std::uint64_t& timestamp)
+    {
+        Reader r(bytes);
+        std::uint32_t number = 0, wireType = 0;
+
+        while (r.next(number, wireType))
+        {
+            if (number == field::HEADER_TIMESTAMP && wireType == VARINT)
+                timestamp = r.varint();
+            else
+                r.skip(wireType);
+        }
+        return r.ok();
+    }
+}
+
+bool WireDecoder::decode(std::string_view data, std::uint64_t& timestamp, TripMap& trips)
+{
+    Reader r(data);
+    std::uint32_t number = 0, wireType = 0;
+    timestamp = 0;
+
+    while (r.next(number, wireType))
+    {
+        if (number == field::FEED_HEADER && wireType == LENGTH_DELIMITED)
+        {
+            if (!decodeHeaderTimestamp(r.bytes(), timestamp))
+                return false;
+        }
+        else if (number == field::FEED_ENTITY && wireType == LENGTH_DELIMITED)
+        {
+            if (!decodeEntity(r.bytes(), trips))
+                return false;
+        }
+        else
+            r.skip(wireType);
+    }
+    return r.ok();
+}
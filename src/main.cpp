@@ -1,16 +1,19 @@
 #include <utility>
 #include <string>
 #include <iostream>
-#include <fstream>
+#include <string_view>
 #include <thread>
 #include <chrono>
 #include <cstdint>
 #include <ctime>
+#include <memory>
+#include <algorithm>
 #include <boost/asio.hpp>
 #include <boost/asio/co_spawn.hpp>
 #include <boost/asio/detached.hpp>
 #include "ConfigurationManager.hpp"
 #include "MtaClient.hpp"
+#include "FeedChangeDetector.hpp"
 
 //Undefine system NO_DATA macro to avoid conflict with protobuf-generated enum
 #ifdef NO_DATA
@@ -22,69 +25,241 @@
 #include "Types.hpp"
 #include "Parser.hpp"
 #include "SQLiteStore.hpp"
-#include "StopManager.hpp"
+#include "StaticData.hpp"
+#include "WarmStart.hpp"
 #include "Dashboard.hpp"
 #include "ReplayEngine.hpp"
+#include "FeedRecorder.hpp"
+#include "VirtualClock.hpp"
+#include "ParseArena.hpp"
+#include "ParsePool.hpp"
+#include "SnapshotWriter.hpp"
+
+// Outcome of one feed within a poll cycle, filled in by pollFeed.
+struct FeedOutcome
+{
+    enum class Status { Pending, Ok, Unchanged, Failed, TimedOut };
+
+    Status status = Status::Pending;
+    std::size_t trains = 0;
+    std::size_t bytesCopied = 0;
+    std::size_t bytesAllocated = 0;
+    std::chrono::steady_clock::duration elapsed{};
+};
+
+// Per-feed state that outlives a single poll cycle.
+struct FeedSlot
+{
+    FeedChangeDetector detector;
+    std::string body;        // response buffer reused across polls; its capacity settles at the feed's peak size
+    ParseArena arena;        // decode memory for this feed, released in one reset at the end of each cycle
+    bool inFlight = false;   // a fetch from an earlier cycle that overran its deadline still owns body
+};
+
+// Shared between runPollingLoop and the per-feed coroutines of one cycle.
+// Held by shared_ptr so a feed that overruns the cycle deadline can still finish safely.
+struct PollCycle
+{
+    explicit PollCycle(boost::asio::io_context& io, std::size_t feedCount)
+        : done(io), outcomes(feedCount), pending(feedCount)
+    {}
+
+    boost::asio::steady_timer done;
+    std::vector<FeedOutcome> outcomes;
+    std::size_t pending;
+    bool closed = false;
+};
 
-boost::asio::awaitable<void> runPollingLoop(MtaClient& client, boost::asio::io_context& io, SQLiteStore& db, StopManager& stops, std::vector<FeedEndpoint> const& feeds, bool recordMode)
+long long toMillis(std::chrono::steady_clock::duration d)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(d).count();
+}
+
+boost::asio::awaitable<void> pollFeed(std::shared_ptr<PollCycle> cycle, std::size_t index, MtaClient& client, ParsePool& parsePool, SnapshotWriter& writer, StaticData const& staticData, FeedEndpoint const& feed, FeedSlot& slot, FeedRecorder* recorder)
+{
+    auto started = std::chrono::steady_clock::now();
+    FeedOutcome::Status status = FeedOutcome::Status::Ok;
+    std::size_t trains = 0;
+    FetchResult fetched;
+
+    slot.inFlight = true;
+    try
+    {
+        fetched = co_await client.fetch(feed.url, slot.body, ConfigurationManager::FEED_TIMEOUT);
+        std::string_view data = fetched.body;
+
+        if (cycle->closed)
+        {
+            std::cerr << "Discarding late response from " << feed.name << "\n";
+            slot.inFlight = false;
+            co_return;
+        }
+
+        if (fetched.notModified)
+        {
+            slot.detector.recordNotModified();
+            status = FeedOutcome::Status::Unchanged;
+        }
+        else if (recorder)
+        {
+            recorder->record(static_cast<std::uint64_t>(std::time(nullptr)), static_cast<std::uint16_t>(index), data);
+        }
+
+        if (status == FeedOutcome::Status::Ok && slot.detector.isUnchanged(data))
+            status = FeedOutcome::Status::Unchanged;
+
+        if (status == FeedOutcome::Status::Ok)
+        {
+            // Decode on a worker, which hands the batch straight to the writer thread;
+            // this coroutine resumes on the io_context with just the count.
+            trains = co_await parsePool.submit([data, &staticData, &slot, &writer]()
+            {
+                // A reload mid-decode swaps the pointer, not the stops this decode is using.
+                auto generation = staticData.current();
+                std::vector<TrainSnapshot> snapshots = Parser::extractSnapshots(data, generation->stops, slot.arena);
+                std::size_t count = snapshots.size();
+                writer.submit(std::move(snapshots));
+                return count;
+            });
+        }
+    }
+    catch (boost::system::system_error const& e)
+    {
+        status = (e.code() == boost::beast::error::timeout) ? FeedOutcome::Status::TimedOut : FeedOutcome::Status::Failed;
+        std::cerr << "Error fetching " << feed.name << ": " << e.what() << std::endl;
+    }
+    catch (std::exception const& e)
+    {
+        status = FeedOutcome::Status::Failed;
+        std::cerr << "Error fetching " << feed.name << ": " << e.what() << std::endl;
+    }
+
+    slot.inFlight = false;
+    if (cycle->closed)
+        co_return;
+
+    FeedOutcome& outcome = cycle->outcomes[index];
+    outcome.status         = status;
+    outcome.trains         = trains;
+    outcome.bytesCopied    = fetched.bytesCopied;
+    outcome.bytesAllocated = fetched.bytesAllocated;
+    outcome.elapsed        = std::chrono::steady_clock::now() - started;
+
+    if (--cycle->pending == 0)
+        cycle->done.cancel();
+}
+
+void reportCycle(PollCycle const& cycle, std::vector<FeedEndpoint> const& feeds, std::vector<FeedSlot> const& slots, std::chrono::steady_clock::duration wall, ClientStats const& client, WriterStats const& writer, FeedRecorder const* recorder)
+{
+    std::size_t totalProcessed = 0;
+    std::size_t totalCopied = 0;
+    std::size_t totalAllocated = 0;
+    std::chrono::steady_clock::duration slowest{};
+
+    for (std::size_t i = 0; i < feeds.size(); ++i)
+    {
+        FeedOutcome const& o = cycle.outcomes[i];
+        std::cout << "   | " << feeds[i].name << ": ";
+
+        switch (o.status)
+        {
+            case FeedOutcome::Status::Ok:       std::cout << o.trains << " trains"; break;
+            case FeedOutcome::Status::Unchanged:
+            {
+                FeedChangeDetector const& d = slots[i].detector;
+                std::cout << "unchanged, skipped (" << d.getNotModifiedSkips() << " not-modified + "
+                          << d.getUnchangedSkips() << " identical of "
+                          << d.getNotModifiedSkips() + d.getUnchangedSkips() + d.getProcessed()
+                          << " polls)";
+            }
+                break;
+            case FeedOutcome::Status::Failed:   std::cout << "FAILED"; break;
+            case FeedOutcome::Status::TimedOut: std::cout << "TIMED OUT"; break;
+            case FeedOutcome::Status::Pending:  std::cout << "NO RESPONSE BY DEADLINE"; break;
+        }
+
+        if (o.status != FeedOutcome::Status::Pending)
+        {
+            std::cout << " (" << toMillis(o.elapsed) << " ms)";
+            slowest = std::max(slowest, o.elapsed);
+        }
+        std::cout << std::endl;
+
+        totalProcessed += o.trains;
+        totalCopied    += o.bytesCopied;
+        totalAllocated += o.bytesAllocated;
+    }
+
+    std::cout << "   -> TOTAL: " << totalProcessed << " trains tracked." << std::endl;
+    std::cout << "   -> Cycle wall time: " << toMillis(wall) << " ms (slowest feed " << toMillis(slowest) << " ms)" << std::endl;
+    std::cout << "   -> Connections since start: " << client.reusedConnections << " reused, "
+              << client.newConnections << " new (" << client.resumedSessions << " TLS resumed), "
+              << client.staleReconnects << " stale reconnects, " << client.dnsLookups << " DNS lookups" << std::endl;
+    std::cout << "   -> Body bytes: " << totalCopied << " copied, " << totalAllocated << " newly allocated" << std::endl;
+    std::cout << "   -> Writer: last commit " << writer.lastCommitRows << " rows from " << writer.lastCommitBatches
+              << " batches in " << writer.lastCommitMicros / 1000.0 << " ms (" << writer.commits << " commits, queue depth "
+              << writer.queueDepth << ")" << std::endl;
+
+    if (recorder)
+    {
+        RecorderStats stats = recorder->getStats();
+        std::cout << "   -> Recorder: " << stats.frames << " frames in " << stats.files << " files, "
+                  << stats.rawBytesPerSecond / 1024 << " KiB/s of feed data (" << stats.storedBytesPerSecond / 1024
+                  << " KiB/s to disk), " << stats.droppedFrames << " dropped, queue depth " << stats.queueDepth << std::endl;
+    }
+}
+
+boost::asio::awaitable<void> runPollingLoop(MtaClient& client, ParsePool& parsePool, SnapshotWriter& writer, boost::asio::io_context& io, StaticData const& staticData, std::vector<FeedEndpoint> const& feeds, FeedRecorder* recorder)
 {
     boost::asio::steady_timer timer(io);
 
     std::cout << "[System] Running initial database cleanup..." << std::endl;
-    db.pruneOldData(7);
+    writer.requestPrune(7);
     auto lastPruneTime = std::chrono::steady_clock::now();
 
-    static std::ofstream recFile;
-    if (recordMode)
-    {
-        recFile.open("recordings/session.rec", std::ios::binary | std::ios::app);
-        std::cout << "[System] Recording activated. Saving to recordings/session.rec" << std::endl;
-    }
+    std::vector<FeedSlot> slots(feeds.size());
 
     for (;;)
     {
         std::cout << "\n[T=" << std::time(nullptr) << "] --- Data Fetch---" << std::endl;
-        int totalProcessed = 0;
 
-        for (const auto& feed : feeds)
+        // Fan out every feed at once. Each fetch carries its own FEED_TIMEOUT; the cycle deadline
+        // adds a little slack on top so a stuck DNS lookup cannot hold the cycle open either.
+        auto cycleStart = std::chrono::steady_clock::now();
+        auto cycle = std::make_shared<PollCycle>(io, feeds.size());
+        cycle->done.expires_at(cycleStart + ConfigurationManager::FEED_TIMEOUT + std::chrono::seconds(2));
+
+        for (std::size_t i = 0; i < feeds.size(); ++i)
         {
-            try
-            {
-                std::string data = co_await client.fetch(feed.url);
-
-                if (recordMode && recFile.is_open())
-                {
-                    uint64_t now = std::time(nullptr);
-                    uint32_t size = static_cast<uint32_t>(data.size());
-                    recFile.write(reinterpret_cast<const char*>(&now), sizeof(now));
-                    recFile.write(reinterpret_cast<const char*>(&size), sizeof(size));
-                    recFile.write(data.data(), size);
-                    recFile.flush();
-                }
-
-                std::vector<TrainSnapshot> snapshots = Parser::extractSnapshots(data, stops);
-
-                if (!snapshots.empty())
-                {
-                    db.insertMany(snapshots);
-                    totalProcessed += static_cast<int>(snapshots.size());
-
-                    std::cout << "   | " << feed.name << ": " << snapshots.size() << " trains." << std::endl;
-                }
-            }
-            catch (std::exception const& e)
+            if (slots[i].inFlight)
             {
-                std::cerr << "Error fetching " << feed.name << ": " << e.what() << std::endl;
+                --cycle->pending;
+                continue;
             }
+            boost::asio::co_spawn(io, pollFeed(cycle, i, client, parsePool, writer, staticData, feeds[i], slots[i], recorder), boost::asio::detached);
+        }
+
+        if (cycle->pending > 0)
+        {
+            boost::system::error_code ec;
+            co_await cycle->done.async_wait(boost::asio::redirect_error(boost::asio::use_awaitable, ec));
         }
+        cycle->closed = true;
+        writer.endCycle();
 
-        std::cout << "   -> TOTAL: " << totalProcessed << " trains tracked." << std::endl;
+        reportCycle(*cycle, feeds, slots, std::chrono::steady_clock::now() - cycleStart, client.getStats(), writer.getStats(), recorder);
+
+        for (FeedSlot& slot : slots)
+        {
+            if (!slot.inFlight)
+                slot.arena.reset();
+        }
 
         auto now = std::chrono::steady_clock::now();
         if (std::chrono::duration_cast<std::chrono::seconds>(now - lastPruneTime).count() > 3600)
         {
             std::cout << "   [Maintenance] Pruning data older than 7 days..." << std::endl;
-            db.pruneOldData(7);
+            writer.requestPrune(7);
             lastPruneTime = now;
         }
 
@@ -93,7 +268,34 @@ boost::asio::awaitable<void> runPollingLoop(MtaClient& client, boost::asio::io_c
     }
 }
 
-boost::asio::awaitable<void> handleHttpClient(std::shared_ptr<boost::asio::ip::tcp::socket> socket, SQLiteStore& db, StopManager& stops)
+std::string httpResponse(const char* status, const char* contentType, std::string const& body)
+{
+    return std::string("HTTP/1.1 ") + status + "\r\n"
+           "Content-Type: " + contentType + "\r\n"
+           "Content-Length: " + std::to_string(body.size()) + "\r\n"
+           "Connection: close\r\n\r\n" +
+           body;
+}
+
+// POST /admin/reload, from this machine only: rebuilds the static GTFS data in the background.
+std::string handleReloadRequest(std::string const& method, boost::asio::ip::tcp::socket const& socket, StaticData& staticData)
+{
+    boost::system::error_code ec;
+    auto peer = socket.remote_endpoint(ec);
+    if (ec || !peer.address().is_loopback())
+        return httpResponse("403 Forbidden", "text/plain", "Reload is only accepted from localhost.\n");
+
+    if (method != "POST")
+        return httpResponse("405 Method Not Allowed", "text/plain", "Use POST.\n");
+
+    if (!staticData.requestReload())
+        return httpResponse("409 Conflict", "text/plain", "A reload is already running.\n");
+
+    std::cout << "[System] Static data reload requested over HTTP." << std::endl;
+    return httpResponse("202 Accepted", "text/plain", "Reload started.\n");
+}
+
+boost::asio::awaitable<void> handleHttpClient(std::shared_ptr<boost::asio::ip::tcp::socket> socket, SQLiteStore& db, StaticData& staticData)
 {
     try
     {
@@ -101,15 +303,24 @@ boost::asio::awaitable<void> handleHttpClient(std::shared_ptr<boost::asio::ip::t
 
         co_await boost::asio::async_read_until(*socket, buffer, "\r\n\r\n", boost::asio::use_awaitable);
 
-        auto stalls = db.getRecentStalls();
-        std::string html = Dashboard::generate(stalls, stops);
+        std::istream request(&buffer);
+        std::string method, target;
+        request >> method >> target;
 
-        std::string response =
-            "HTTP/1.1 200 OK\r\n"
-            "Content-Type: text/html\r\n"
-            "Content-Length: " + std::to_string(html.size()) + "\r\n"
-            "Connection: close\r\n\r\n" +
-            html;
+        std::string response;
+        if (target == "/admin/reload")
+        {
+            response = handleReloadRequest(method, *socket, staticData);
+        }
+        else
+        {
+            // One generation per page, even if a reload lands while it renders.
+            auto generation = staticData.current();
+            auto stalls = db.getRecentStalls();
+            auto now = static_cast<std::int64_t>(VirtualClock::now());
+            auto lastDay = db.getDwellPercentiles(now - 86400, now);
+            response = httpResponse("200 OK", "text/html", Dashboard::generate(*stalls, lastDay, generation->stops));
+        }
 
         co_await boost::asio::async_write(*socket, boost::asio::buffer(response), boost::asio::use_awaitable);
 
@@ -135,18 +346,18 @@ boost::asio::awaitable<void> handleHttpClient(std::shared_ptr<boost::asio::ip::t
     }
 }
 
-boost::asio::awaitable<void> httpAcceptLoop(boost::asio::ip::tcp::acceptor& acceptor, SQLiteStore& db, StopManager& stops)
+boost::asio::awaitable<void> httpAcceptLoop(boost::asio::ip::tcp::acceptor& acceptor, SQLiteStore& db, StaticData& staticData)
 {
     for (;;)
     {
         auto socket = std::make_shared<boost::asio::ip::tcp::socket>(co_await boost::asio::this_coro::executor);
 
         co_await acceptor.async_accept(*socket, boost::asio::use_awaitable);
-        boost::asio::co_spawn(socket->get_executor(), handleHttpClient(socket, db, stops), boost::asio::detached);
+        boost::asio::co_spawn(socket->get_executor(), handleHttpClient(socket, db, staticData), boost::asio::detached);
     }
 }
 
-void runHttpServer(SQLiteStore& db, StopManager& stops)
+void runHttpServer(SQLiteStore& db, StaticData& staticData)
 {
     try
     {
@@ -155,7 +366,7 @@ void runHttpServer(SQLiteStore& db, StopManager& stops)
 
         std::cout << "   -> Dashboard active at http://localhost:8080\n";
 
-        boost::asio::co_spawn(ioc, httpAcceptLoop(acceptor, db, stops), boost::asio::detached);
+        boost::asio::co_spawn(ioc, httpAcceptLoop(acceptor, db, staticData), boost::asio::detached);
 
         ioc.run();
     }
@@ -165,11 +376,79 @@ void runHttpServer(SQLiteStore& db, StopManager& stops)
     }
 }
 
-void parseCommandLineArgs(int argc, char* argv[], bool& recordMode, bool& replayMode, std::string& replayFile)
+// Refreshes the warm-start file so a crash loses at most one interval of in-flight state.
+boost::asio::awaitable<void> runWarmStartLoop(boost::asio::io_context& io, WarmStart& warmStart, StaticData const& staticData, SQLiteStore& db)
 {
-    recordMode = false;
-    replayMode = false;
-    replayFile.clear();
+    boost::asio::steady_timer timer(io);
+    for (;;)
+    {
+        timer.expires_after(std::chrono::minutes(5));
+        co_await timer.async_wait(boost::asio::use_awaitable);
+        warmStart.save(*staticData.current(), db);
+    }
+}
+
+// Bounds how much of a recording a crash can lose; each sync also refreshes the recorder's rates.
+boost::asio::awaitable<void> runRecorderSyncLoop(boost::asio::io_context& io, FeedRecorder& recorder)
+{
+    boost::asio::steady_timer timer(io);
+    for (;;)
+    {
+        timer.expires_after(recorder.getPolicy().syncInterval);
+        co_await timer.async_wait(boost::asio::use_awaitable);
+        recorder.requestSync();
+    }
+}
+
+// The schedule holds one service day; this swaps in the next one shortly after midnight.
+boost::asio::awaitable<void> runServiceDayLoop(boost::asio::io_context& io, StaticData& staticData)
+{
+    boost::asio::steady_timer timer(io);
+    for (;;)
+    {
+        timer.expires_after(std::chrono::minutes(1));
+        co_await timer.async_wait(boost::asio::use_awaitable);
+        if (staticData.ensureServiceDay(VirtualClock::now()))
+            std::cout << "[System] New service day; rebuilding the schedule index..." << std::endl;
+    }
+}
+
+void printMigrationReport(IntervalMigrationReport const& report)
+{
+    auto size = [](std::int64_t bytes)
+    {
+        return bytes < 0 ? std::string("n/a") : std::to_string(bytes / 1024) + " KB";
+    };
+
+    std::cout << "[System] Migrated " << report.migratedRows << " snapshot rows into intervals.\n"
+              << "   Snapshots: " << report.snapshotRows << " rows, " << size(report.snapshotBytes)
+              << ", dwell query " << report.snapshotQueryMicros << " us (" << report.snapshotStalls << " stalls)\n"
+              << "   Intervals: " << report.intervalRows << " rows, " << size(report.intervalBytes)
+              << ", dwell query " << report.intervalQueryMicros << " us (" << report.intervalStalls << " stalls)"
+              << std::endl;
+}
+
+struct CommandLineOptions
+{
+    bool recordMode = false;
+    std::string recordPath;    // empty: recordings/session-<UTC start time>.rec
+    RecordingPolicy recordPolicy;
+    bool replayMode = false;
+    std::string replayFile;
+    ReplaySettings replaySettings;
+    bool ingestMode = false;    // replay flat out without the dashboard, then exit
+    std::string dbPath = "mtaHistory.db";
+    bool verifyDecoderMode = false;
+    std::string verifyFile;
+    std::size_t parseThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::size_t dbReaders = SQLiteStore::DEFAULT_READERS;
+    SQLiteStore::StorageMode storageMode = SQLiteStore::StorageMode::Snapshots;
+    bool migrateIntervalsMode = false;
+};
+
+CommandLineOptions parseCommandLineArgs(int argc, char* argv[])
+{
+    CommandLineOptions options;
 
     for (int i = 1; i < argc; ++i)
     {
@@ -177,60 +456,251 @@ void parseCommandLineArgs(int argc, char* argv[], bool& recordMode, bool& replay
 
         if (arg == "--record")
         {
-            recordMode = true;
+            options.recordMode = true;
+            if (i + 1 < argc && std::string_view(argv[i + 1]).substr(0, 2) != "--")
+                options.recordPath = argv[++i];
+        }
+        else if (arg == "--record-max-mb" && i + 1 < argc)
+        {
+            options.recordPolicy.maxFileBytes = std::stoull(argv[++i]) << 20;
+        }
+        else if (arg == "--record-hourly")
+        {
+            options.recordPolicy.hourly = true;
+        }
+        else if (arg == "--record-delta" && i + 1 < argc)
+        {
+            options.recordPolicy.keyframeInterval = static_cast<std::uint32_t>(std::stoul(argv[++i]));
+        }
+        else if (arg == "--record-sync" && i + 1 < argc)
+        {
+            options.recordPolicy.syncInterval = std::chrono::seconds(std::max(1ul, std::stoul(argv[++i])));
         }
         else if (arg == "--replay" && i + 1 < argc)
         {
-            replayMode = true;
-            replayFile = argv[++i];
+            options.replayMode = true;
+            options.replayFile = argv[++i];
+        }
+        else if (arg == "--ingest" && i + 1 < argc)
+        {
+            options.ingestMode = true;
+            options.replayFile = argv[++i];
+        }
+        else if (arg == "--db" && i + 1 < argc)
+        {
+            options.dbPath = argv[++i];
+        }
+        else if (arg == "--replay-from" && i + 1 < argc)
+        {
+            options.replaySettings.fromTimestamp = std::stoull(argv[++i]);
+        }
+        else if (arg == "--replay-speed" && i + 1 < argc)
+        {
+            std::string speed = argv[++i];
+            options.replaySettings.speed = (speed == "max") ? 0.0 : std::max(0.0, std::stod(speed));
+        }
+        else if (arg == "--wire-decoder")
+        {
+            Parser::setDefaultDecoder(Parser::Decoder::Wire);
+        }
+        else if (arg == "--parse-threads" && i + 1 < argc)
+        {
+            options.parseThreads = static_cast<std::size_t>(std::stoul(argv[++i]));
+        }
+        else if (arg == "--db-readers" && i + 1 < argc)
+        {
+            options.dbReaders = static_cast<std::size_t>(std::stoul(argv[++i]));
+        }
+        else if (arg == "--storage" && i + 1 < argc)
+        {
+            std::string mode = argv[++i];
+            if (mode == "intervals")
+                options.storageMode = SQLiteStore::StorageMode::Intervals;
+            else if (mode == "snapshots")
+                options.storageMode = SQLiteStore::StorageMode::Snapshots;
+            else
+                std::cerr << "Warning: unknown storage mode '" << mode << "', using snapshots\n";
+        }
+        else if (arg == "--migrate-intervals")
+        {
+            options.migrateIntervalsMode = true;
+        }
+        else if (arg == "--verify-decoder" && i + 1 < argc)
+        {
+            options.verifyDecoderMode = true;
+            options.verifyFile = argv[++i];
         }
         else
         {
             std::cerr << "Warning: ignoring unknown or malformed argument: " << arg << "\n";
         }
     }
+
+    options.replaySettings.parseThreads = options.parseThreads;
+    if (options.ingestMode)
+        options.replaySettings.speed = 0.0;
+
+    return options;
+}
+
+// SIGINT/SIGTERM stop the live loop; SIGHUP reloads the static GTFS data without stopping anything.
+boost::asio::awaitable<void> handleSignals(boost::asio::io_context& io, StaticData& staticData)
+{
+    boost::asio::signal_set signals(io, SIGINT, SIGTERM);
+#ifdef SIGHUP
+    signals.add(SIGHUP);
+#endif
+
+    for (;;)
+    {
+        int signal = co_await signals.async_wait(boost::asio::use_awaitable);
+#ifdef SIGHUP
+        if (signal == SIGHUP)
+        {
+            if (staticData.requestReload())
+                std::cout << "[System] SIGHUP: reloading static GTFS data..." << std::endl;
+            else
+                std::cout << "[System] SIGHUP: a reload is already running." << std::endl;
+            continue;
+        }
+#endif
+        std::cout << "[System] Shutting down..." << std::endl;
+        io.stop();
+        co_return;
+    }
+}
+
+// recordings/session-<UTC start time>.rec, one file per run.
+std::string newRecordingPath()
+{
+    std::time_t now = std::time(nullptr);
+    char path[64];
+    std::strftime(path, sizeof(path), "recordings/session-%Y%m%d-%H%M%S.rec", std::gmtime(&now));
+    return path;
+}
+
+// Polls the live feeds until SIGINT/SIGTERM.
+void runLive(CommandLineOptions const& options, SQLiteStore& db, StaticData& staticData, WarmStart& warmStart)
+{
+    boost::asio::io_context io;
+    ConfigurationManager config;
+    MtaClient client(io, config.getAPIKey());
+    // Declared before the pool: a decode still running at shutdown hands its batch to the writer.
+    SnapshotWriter writer(db);
+    ParsePool parsePool(options.parseThreads);
+    const auto& feeds = config.getFeeds();
+
+    // Drains its queue and closes the last file when runLive returns, after the io_context has stopped.
+    std::unique_ptr<FeedRecorder> recorder;
+    if (options.recordMode)
+    {
+        std::vector<std::string> feedNames;
+        for (FeedEndpoint const& feed : feeds)
+            feedNames.push_back(feed.name);
+
+        std::string path = options.recordPath.empty() ? newRecordingPath() : options.recordPath;
+        recorder = std::make_unique<FeedRecorder>(path, std::move(feedNames), options.recordPolicy);
+        std::cout << "[System] Recording activated. Saving to " << path << std::endl;
+        boost::asio::co_spawn(io, runRecorderSyncLoop(io, *recorder), boost::asio::detached);
+    }
+
+    boost::asio::co_spawn(io, runPollingLoop(client, parsePool, writer, io, staticData, feeds, recorder.get()), boost::asio::detached);
+    boost::asio::co_spawn(io, runWarmStartLoop(io, warmStart, staticData, db), boost::asio::detached);
+    boost::asio::co_spawn(io, runServiceDayLoop(io, staticData), boost::asio::detached);
+    boost::asio::co_spawn(io, handleSignals(io, staticData), boost::asio::detached);
+
+    io.run();
 }
 
+// Wall time of each startup step, printed as it finishes.
+struct StartupTimer
+{
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+
+    void phase(const char* name)
+    {
+        auto now = std::chrono::steady_clock::now();
+        auto micros = std::chrono::duration_cast<std::chrono::microseconds>(now - started).count();
+        std::cout << "[System] Startup: " << name << " took " << micros / 1000.0 << " ms." << std::endl;
+        started = now;
+    }
+};
+
 int main(int argc, char* argv[])
 {
     try
     {
-        bool replayMode = false;
-        bool recordMode = false;
-        std::string replayFile;
+        CommandLineOptions options = parseCommandLineArgs(argc, argv);
 
-        parseCommandLineArgs(argc, argv, recordMode, replayMode, replayFile);
+        StartupTimer startup;
 
-        boost::asio::io_context io;
-        StopManager stops("data/stops.txt");
-        auto terminals = Parser::detectTerminals("data/stop_times.txt", stops);
-        stops.loadTerminals(terminals);
+        StaticData staticData("data/stops.txt", "data/stop_times.txt", "data/trips.txt");
+        std::uint64_t sourceHash = staticData.hashSources();
+        startup.phase("GTFS hash");
 
-        SQLiteStore db("mtaHistory.db");
-        db.importStaticSchedule("data/stop_times.txt");
+        // Each database keeps its own, so one never restores another's trains.
+        WarmStart warmStart(options.dbPath + ".warm");
+        std::string warmDwellState;
+        auto generation = std::make_shared<StaticGeneration>();
+
+        if (warmStart.load(sourceHash, *generation, warmDwellState))
+        {
+            generation->number = 1;
+            startup.phase("warm-start load");
+        }
+        else
+        {
+            generation = staticData.build(1, sourceHash, ServiceDay::containing(VirtualClock::now()));
+            startup.phase("static data build");
+        }
+        staticData.publish(std::move(generation));
+        // A warm start saved on an earlier service day serves its schedule until the rebuild lands.
+        staticData.ensureServiceDay(VirtualClock::now());
+
+        if (options.verifyDecoderMode)
+        {
+            return ReplayEngine::verifyDecoders(options.verifyFile, staticData.current()->stops) ? 0 : 1;
+        }
+
+        // A replay runs on recorded time, so live in-flight state would only get in its way.
+        const bool offline = options.replayMode || options.ingestMode;
+        SQLiteStore db(options.dbPath, options.dbReaders, options.storageMode,
+                       offline ? std::string_view() : std::string_view(warmDwellState));
+        warmDwellState.clear();
+        db.setStaticData(&staticData);
+        startup.phase("database open");
+
+        if (options.migrateIntervalsMode)
+        {
+            printMigrationReport(db.migrateToIntervals());
+            return 0;
+        }
+
+        if (options.ingestMode)
+        {
+            return ReplayEngine::run(options.replayFile, db, staticData, options.replaySettings) ? 0 : 1;
+        }
 
         std::cout << "System Initialized.\n";
-        std::thread serverThread([&db, &stops]()
+        std::thread serverThread([&db, &staticData]()
         {
-            runHttpServer(db, stops);
+            runHttpServer(db, staticData);
         });
         serverThread.detach();
 
-        if (replayMode)
+        if (options.replayMode)
         {
-            ReplayEngine::run(replayFile, db, stops);
+            ReplayEngine::run(options.replayFile, db, staticData, options.replaySettings);
             std::cout << "Replay Finished. Dashboard is static. Press Enter to exit." << std::endl;
             std::cin.get();
         }
         else
         {
-            ConfigurationManager config;
-            MtaClient client(io, config.getAPIKey());
-            const auto& feeds = config.getFeeds();
-
-            boost::asio::co_spawn(io, runPollingLoop(client, io, db, stops, feeds, recordMode), boost::asio::detached);
+            runLive(options, db, staticData, warmStart);
 
-            io.run();
+            // The writer drained its queue before runLive returned, so the saved dwell state is current.
+            if (warmStart.save(*staticData.current(), db))
+                std::cout << "[System] Saved warm-start state." << std::endl;
         }
     }
     catch (const std::exception& e)